@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    HalfBandOversampler.h
+
+    Polyphase IIR half-band filters for 2x up- and downsampling, without JUCE,
+    for the core library.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+//==============================================================================
+/**
+    A half-band lowpass built from two chains of first-order allpasses in z^2,
+
+        H (z) = (A0 (z^2) + z^-1 A1 (z^2)) / 2,
+
+    which is the structure behind juce::dsp::Oversampling's
+    filterHalfBandPolyphaseIIR as well. Running each chain at the lower rate
+    makes a 2x up- or downsampling step cost one multiply per coefficient and
+    sample, and the allpasses need no normalisation to stay stable.
+
+    The coefficients are the elliptic design from the transition bandwidth and
+    the number of coefficients (see design()), alternating between A0 and A1.
+    The stopband attenuation is roughly 13 dB per coefficient for a transition
+    of 0.025, and 29 dB per coefficient for 0.125. An object holds the state of
+    one channel in one direction.
+*/
+template <typename Type>
+class HalfBandOversampler
+{
+public:
+    static constexpr int maxCoefficients = 12;
+
+    //==============================================================================
+    /** Fills coefficients with an elliptic half-band design.
+
+        @param transition       the transition band, as a fraction of the higher rate, between
+                                0.25 - transition and 0.25 + transition of it
+        @param numCoefficients  allpasses over both chains, up to maxCoefficients
+    */
+    static void design (double transition, int numCoefficients, double* coefficients) noexcept
+    {
+        constexpr auto pi = 3.14159265358979323846;
+
+        // the elliptic modulus of the transition band, and its nome q
+        auto k = std::tan ((1.0 - 4.0 * transition) * pi / 4.0);
+        k *= k;
+        const auto root = std::pow (1.0 - k * k, 0.25);
+        const auto e = 0.5 * (1.0 - root) / (1.0 + root);
+        const auto e4 = e * e * e * e;
+        const auto q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+        const auto order = 2 * numCoefficients + 1;
+
+        for (int index = 0; index < numCoefficients; ++index)
+        {
+            const auto c = index + 1;
+            auto numerator = 0.0, denominator = 0.0;
+
+            // the theta series of the pole positions, summed until the terms vanish
+            for (int i = 0, sign = 1; i < 64; ++i, sign = -sign)
+            {
+                const auto term = std::pow (q, i * (i + 1)) * std::sin ((2 * i + 1) * c * pi / order) * sign;
+                numerator += term;
+
+                if (std::abs (term) < 1.0e-100)
+                    break;
+            }
+
+            for (int i = 1, sign = -1; i < 64; ++i, sign = -sign)
+            {
+                const auto term = std::pow (q, i * i) * std::cos (2 * i * c * pi / order) * sign;
+                denominator += term;
+
+                if (std::abs (term) < 1.0e-100)
+                    break;
+            }
+
+            const auto w = numerator * std::pow (q, 0.25) / (denominator + 0.5);
+            const auto w2 = w * w;
+            const auto x = std::sqrt ((1.0 - w2 * k) * (1.0 - w2 / k)) / (1.0 + w2);
+
+            coefficients[index] = (1.0 - x) / (1.0 + x);
+        }
+    }
+
+    /** The latency an upsample followed by a downsample through the same design adds
+        at low frequencies, in samples at the lower rate.
+    */
+    static double getLatency (const double* coefficients, int numCoefficients) noexcept
+    {
+        // every allpass delays DC by (1 - a) / (1 + a) samples at its own, lower rate; the two
+        // chains are averaged, and the two directions add up to the sum over all coefficients
+        auto latency = 0.0;
+
+        for (int i = 0; i < numCoefficients; ++i)
+            latency += (1.0 - coefficients[i]) / (1.0 + coefficients[i]);
+
+        return latency;
+    }
+
+    //==============================================================================
+    void setCoefficients (const double* newCoefficients, int newNumCoefficients) noexcept
+    {
+        numCoefficients = newNumCoefficients < maxCoefficients ? newNumCoefficients : maxCoefficients;
+
+        for (int i = 0; i < numCoefficients; ++i)
+            coefficients[i] = (Type) newCoefficients[i];
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (int i = 0; i < maxCoefficients; ++i)
+            x[i] = y[i] = 0;
+    }
+
+    /** Writes 2 numSamples samples at the higher rate for numSamples input samples, spaced inputStride apart. */
+    void upsample (const Type* input, int inputStride, Type* output, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            Type even = input[i * inputStride], odd = even;
+            processPair (even, odd);
+
+            output[2 * i] = even;
+            output[2 * i + 1] = odd;
+        }
+    }
+
+    /** Writes numSamples samples, spaced outputStride apart, for 2 numSamples input samples at the higher rate. */
+    void downsample (const Type* input, Type* output, int outputStride, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            Type even = input[2 * i + 1], odd = input[2 * i];
+            processPair (even, odd);
+
+            output[i * outputStride] = (Type) 0.5 * (even + odd);
+        }
+    }
+
+private:
+    /** Runs one sample through each chain, A0 on even and A1 on odd. */
+    void processPair (Type& even, Type& odd) noexcept
+    {
+        for (int i = 0; i < numCoefficients; i += 2)
+        {
+            const auto outEven = (even - y[i]) * coefficients[i] + x[i];
+            x[i] = even;
+            y[i] = outEven;
+            even = outEven;
+
+            if (i + 1 < numCoefficients)
+            {
+                const auto outOdd = (odd - y[i + 1]) * coefficients[i + 1] + x[i + 1];
+                x[i + 1] = odd;
+                y[i + 1] = outOdd;
+                odd = outOdd;
+            }
+        }
+    }
+
+    Type coefficients[maxCoefficients] = {};
+    Type x[maxCoefficients] = {}, y[maxCoefficients] = {};
+    int numCoefficients = 0;
+};
@@ -0,0 +1,296 @@
+/*
+  ==============================================================================
+
+    LadderEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "LadderEngine.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP > 0)
+ #include <xmmintrin.h>
+ #define VCF_CORE_HAS_MXCSR 1
+#else
+ #define VCF_CORE_HAS_MXCSR 0
+#endif
+
+namespace
+{
+    // The first stage is steep enough to keep the band up to 0.45 of the host rate and
+    // reject what would alias into it; the ones above only have to clear that band.
+    constexpr double firstStageTransition = 0.025;
+    constexpr int firstStageCoefficients = 8;   // 106 dB
+    constexpr double upperStageTransition = 0.125;
+    constexpr int upperStageCoefficients = 4;   // 116 dB
+
+    /** Flushes denormals to zero while the ladder rings out, and restores the caller's mode after. */
+    struct ScopedNoDenormals
+    {
+       #if VCF_CORE_HAS_MXCSR
+        ScopedNoDenormals() noexcept : mode (_mm_getcsr())   { _mm_setcsr (mode | 0x8040); } // FTZ | DAZ
+        ~ScopedNoDenormals() noexcept                        { _mm_setcsr (mode); }
+
+        unsigned int mode;
+       #endif
+    };
+}
+
+//==============================================================================
+void LadderEngine::prepare (double newSampleRate, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    numChannels = std::clamp (newNumChannels, 1, maxChannels);
+
+    double coefficientsOfStage[HalfBandOversampler<float>::maxCoefficients];
+    channels.assign ((size_t) numChannels, {});
+
+    for (int stage = 0; stage < maxOversamplingStages; ++stage)
+    {
+        auto transition = stage == 0 ? firstStageTransition : upperStageTransition;
+        auto numCoefficients = stage == 0 ? firstStageCoefficients : upperStageCoefficients;
+
+        HalfBandOversampler<float>::design (transition, numCoefficients, coefficientsOfStage);
+        stageLatency[stage] = HalfBandOversampler<float>::getLatency (coefficientsOfStage, numCoefficients);
+
+        for (auto& channel : channels)
+        {
+            channel.up[stage].setCoefficients (coefficientsOfStage, numCoefficients);
+            channel.down[stage].setCoefficients (coefficientsOfStage, numCoefficients);
+        }
+    }
+
+    for (auto& channel : channels)
+        for (auto& buffer : channel.buffers)
+            buffer.assign ((size_t) subBlockSamples, 0.0f);
+
+    states.resize ((size_t) ((numChannels + numLanes - 1) / numLanes));
+    reset();
+}
+
+void LadderEngine::reset() noexcept
+{
+    for (auto& channel : channels)
+    {
+        for (auto& filter : channel.up)
+            filter.reset();
+
+        for (auto& filter : channel.down)
+            filter.reset();
+    }
+
+    for (auto& state : states)
+        state.reset();
+
+    cutoffRamp.reset (std::log2 (getLimitedCutoff()));
+    feedbackRamp.reset (feedback.load());
+    thermalVoltageRamp.reset (thermalVoltage.load());
+
+    // the next block starts straight at its constants
+    activeStages = -1;
+    activeOrder = ladderOrder.load();
+}
+
+int LadderEngine::getLatencySamples() const noexcept
+{
+    // each stage's latency counts in samples at its lower rate, which halves from one stage to the next
+    auto latency = 0.0;
+
+    for (int stage = 0; stage < oversamplingStages.load(); ++stage)
+        latency += stageLatency[stage] / (double) (1 << stage);
+
+    return (int) std::lround (latency);
+}
+
+double LadderEngine::getLimitedCutoff() const noexcept
+{
+    auto hz = cutoff.load();
+    return sampleRate > 0.0 ? std::min (hz, maxCutoffRatio * sampleRate) : hz;
+}
+
+//==============================================================================
+void LadderEngine::process (const float* const* input, float* const* output, int stride, int numFrames) noexcept
+{
+    if (! isPrepared() || numFrames <= 0)
+        return;
+
+    ScopedNoDenormals noDenormals;
+
+    auto stages = oversamplingStages.load();
+    auto snapCoefficients = stages != activeStages;
+
+    // the filters of a new factor start from silence, the ladder carries over
+    if (snapCoefficients)
+    {
+        for (auto& channel : channels)
+        {
+            for (int stage = 0; stage < maxOversamplingStages; ++stage)
+            {
+                channel.up[stage].reset();
+                channel.down[stage].reset();
+            }
+        }
+
+        activeStages = stages;
+    }
+
+    // a stage the new order did not use so far starts from rest
+    auto order = ladderOrder.load();
+
+    if (order != activeOrder)
+    {
+        for (auto& state : states)
+            state.resetStagesFrom (std::min (order, activeOrder));
+
+        activeOrder = order;
+    }
+
+    activeQuality = quality.load();
+    auto fixed = fixedCost.load();
+
+    auto factor = 1 << stages;
+    auto rate = sampleRate * factor;
+    auto rampSamples = (int) (parameterRampSeconds * sampleRate);
+
+    cutoffRamp.setTarget (std::log2 (getLimitedCutoff()), rampSamples);
+    feedbackRamp.setTarget (feedback.load(), rampSamples);
+    thermalVoltageRamp.setTarget (thermalVoltage.load(), rampSamples);
+
+    auto subBlockSize = subBlockSamples / factor;
+    float* channelData[maxChannels] = {};
+
+    for (int start = 0; start < numFrames; start += subBlockSize)
+    {
+        auto numSubBlockFrames = std::min (subBlockSize, numFrames - start);
+        auto numSamples = numSubBlockFrames * factor;
+
+        // the ramps are evaluated at the end of the sub-block, and the solver constants ramp linearly up to there
+        auto f0 = std::exp2 (cutoffRamp.skip (numSubBlockFrames));
+        auto k = feedbackRamp.skip (numSubBlockFrames);
+        auto vt = thermalVoltageRamp.skip (numSubBlockFrames);
+
+        LadderCircuit::setCoefficients (targetCoefficients, f0, k, vt, rate);
+        targetCoefficients.setPredictor (LadderPredictor::quadratic);
+
+        if (snapCoefficients)
+        {
+            coefficients = targetCoefficients;
+            snapCoefficients = false;
+        }
+
+        coefficientRamp.set (coefficients, targetCoefficients, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channelData[channel] = upsample (channels[(size_t) channel], input[channel] + (size_t) start * (size_t) stride, stride, numSubBlockFrames);
+
+        switch (order)
+        {
+            case 2:  fixed ? solveOfOrder<ladderFixedIterations, 2> (channelData, numSamples) : solveOfOrder<0, 2> (channelData, numSamples); break;
+            case 6:  fixed ? solveOfOrder<ladderFixedIterations, 6> (channelData, numSamples) : solveOfOrder<0, 6> (channelData, numSamples); break;
+            case 8:  fixed ? solveOfOrder<ladderFixedIterations, 8> (channelData, numSamples) : solveOfOrder<0, 8> (channelData, numSamples); break;
+            case 4:
+            default: fixed ? solveOfOrder<ladderFixedIterations, 4> (channelData, numSamples) : solveOfOrder<0, 4> (channelData, numSamples); break;
+        }
+
+        coefficients = targetCoefficients;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            downsample (channels[(size_t) channel], output[channel] + (size_t) start * (size_t) stride, stride, numSubBlockFrames);
+    }
+}
+
+float* LadderEngine::upsample (Channel& channel, const float* input, int stride, int numFrames) noexcept
+{
+    // the stages take turns between the two buffers, the first one reading the host's samples
+    auto* destination = channel.buffers[0].data();
+
+    if (activeStages == 0)
+    {
+        for (int i = 0; i < numFrames; ++i)
+            destination[i] = input[i * stride];
+
+        return destination;
+    }
+
+    channel.up[0].upsample (input, stride, destination, numFrames);
+
+    for (int stage = 1; stage < activeStages; ++stage)
+    {
+        auto* source = destination;
+        destination = channel.buffers[(size_t) (stage % 2)].data();
+        channel.up[stage].upsample (source, 1, destination, numFrames << stage);
+    }
+
+    return destination;
+}
+
+void LadderEngine::downsample (Channel& channel, float* output, int stride, int numFrames) noexcept
+{
+    if (activeStages == 0)
+    {
+        auto* source = channel.buffers[0].data();
+
+        for (int i = 0; i < numFrames; ++i)
+            output[i * stride] = source[i];
+
+        return;
+    }
+
+    // back down the same way, from the buffer the last stage up wrote and the solver overwrote
+    auto* source = channel.buffers[(size_t) ((activeStages - 1) % 2)].data();
+
+    for (int stage = activeStages - 1; stage > 0; --stage)
+    {
+        auto* destination = channel.buffers[(size_t) ((stage + 1) % 2)].data();
+        channel.down[stage].downsample (source, destination, 1, numFrames << stage);
+        source = destination;
+    }
+
+    channel.down[0].downsample (source, output, stride, numFrames);
+}
+
+//==============================================================================
+template <int fixedIterations, int order>
+void LadderEngine::solveOfOrder (float* const* channelData, int numSamples) noexcept
+{
+    switch (static_cast<Nonlinearities::Quality> (activeQuality))
+    {
+        case Nonlinearities::Quality::pade:        solve<Nonlinearities::PadeTanh, fixedIterations, order> (channelData, numSamples); break;
+        case Nonlinearities::Quality::table:       solve<Nonlinearities::TableTanh, fixedIterations, order> (channelData, numSamples); break;
+        case Nonlinearities::Quality::antialiased: solve<Nonlinearities::AntialiasedTanh, fixedIterations, order> (channelData, numSamples); break;
+        case Nonlinearities::Quality::exact:
+        default:                                   solve<Nonlinearities::ExactTanh, fixedIterations, order> (channelData, numSamples); break;
+    }
+}
+
+template <typename Nonlinearity, int fixedIterations, int order>
+void LadderEngine::solve (float* const* channelData, int numSamples) noexcept
+{
+    // all channels of a group go through the solver together, unused lanes see silence
+    for (int group = 0; group < (int) states.size(); ++group)
+    {
+        auto& state = states[(size_t) group];
+        auto* groupData = channelData + group * numLanes;
+        auto numGroupLanes = std::min (numLanes, numChannels - group * numLanes);
+
+        float vin[numLanes] = {}, vout[numLanes];
+        auto groupCoefficients = coefficients;
+        bool converged;
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            for (int lane = 0; lane < numGroupLanes; ++lane)
+                vin[lane] = groupData[lane][sample];
+
+            if (coefficientRamp.active)
+                coefficientRamp.apply (groupCoefficients);
+
+            LadderSolver<Nonlinearity, numLanes, float, fixedIterations, order>::processSample (groupCoefficients, state, vin, vout, converged);
+
+            for (int lane = 0; lane < numGroupLanes; ++lane)
+                groupData[lane][sample] = vout[lane];
+        }
+    }
+}
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    LadderEngine.h
+
+    The ladder filter without JUCE: oversampling, parameter ramps and the
+    solver, for embedding through the C API in VCFCore.h.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "LadderSolver.h"
+#include "HalfBandOversampler.h"
+
+//==============================================================================
+/**
+    One filter instance: up to maxChannels channels, each through its own
+    oversampler and ladder lane, all with the same settings. Everything is
+    allocated in prepare(), so process() never allocates, locks or waits, and
+    no two instances share anything but the read-only tanh and cutoff tables.
+
+    The settings can be changed from any thread, and process() picks them up
+    on its next call. Cutoff, feedback and Vt ramp over parameterRampSeconds
+    like the plugin's controls; a new oversampling factor or order applies at
+    once, with the filters or stages it brings in starting from rest. The
+    output is always the lowpass; the mixed responses are a build option of
+    the plugin only (see LadderTaps).
+
+    Audio runs in sub-blocks of subBlockSamples solver samples, read from the
+    input and written to the output with a stride, so planar, interleaved and
+    in-place buffers are all processed where they are.
+*/
+class LadderEngine
+{
+public:
+    static constexpr int maxChannels = 16;
+    static constexpr int maxOversamplingStages = 4; // 16x
+    static constexpr int subBlockSamples = 256;
+    static constexpr double parameterRampSeconds = 0.02;
+
+    // the control ranges, as the plugin's parameters have them apart from the wider cutoff
+    static constexpr double minCutoff = 1.0, maxCutoffRatio = 0.45; // of the host rate
+    static constexpr double maxFeedback = 4.0;
+    static constexpr double minThermalVoltage = LadderCircuit::minControlVoltage, maxThermalVoltage = 0.05;
+
+    //==============================================================================
+    /** Sizes everything for a host rate and channel count, and resets. Throws std::bad_alloc. */
+    void prepare (double newSampleRate, int newNumChannels);
+
+    /** Clears the ladder and filter states, and jumps the ramps to their targets. */
+    void reset() noexcept;
+
+    bool isPrepared() const noexcept         { return numChannels > 0; }
+    int getNumChannels() const noexcept      { return numChannels; }
+
+    /** Latency of the current oversampling setting, in samples at the host rate. */
+    int getLatencySamples() const noexcept;
+
+    /** Filters numFrames frames of every channel. Frame i of channel c is read from
+        input[c][i * stride] and written to output[c][i * stride]; output may be input.
+    */
+    void process (const float* const* input, float* const* output, int stride, int numFrames) noexcept;
+
+    //==============================================================================
+    void setCutoff (double hz) noexcept                     { cutoff = hz < minCutoff ? minCutoff : hz; } // the upper limit follows the rate
+    void setFeedback (double k) noexcept                    { feedback = k < 0.0 ? 0.0 : (k > maxFeedback ? maxFeedback : k); }
+    void setThermalVoltage (double vt) noexcept             { thermalVoltage = vt < minThermalVoltage ? minThermalVoltage : (vt > maxThermalVoltage ? maxThermalVoltage : vt); }
+    void setQuality (Nonlinearities::Quality newQuality) noexcept { quality = (int) newQuality; }
+    void setOversamplingStages (int stages) noexcept        { oversamplingStages = stages < 0 ? 0 : (stages > maxOversamplingStages ? maxOversamplingStages : stages); }
+    void setOrder (int order) noexcept                      { ladderOrder = order <= 2 ? 2 : (order >= ladderMaxOrder ? ladderMaxOrder : order & ~1); }
+    void setFixedCost (bool fixed) noexcept                 { fixedCost = fixed; }
+
+    double getCutoff() const noexcept                       { return cutoff; }
+    double getFeedback() const noexcept                     { return feedback; }
+    double getThermalVoltage() const noexcept               { return thermalVoltage; }
+    Nonlinearities::Quality getQuality() const noexcept     { return static_cast<Nonlinearities::Quality> (quality.load()); }
+    int getOversamplingStages() const noexcept              { return oversamplingStages; }
+    int getOrder() const noexcept                           { return ladderOrder; }
+    bool getFixedCost() const noexcept                      { return fixedCost; }
+
+private:
+    //==============================================================================
+    /** The oversampling filters of one channel, a pair per 2x stage, and the buffers they work in. */
+    struct Channel
+    {
+        HalfBandOversampler<float> up[maxOversamplingStages], down[maxOversamplingStages];
+        std::vector<float> buffers[2];
+    };
+
+    static constexpr int numLanes = ladderLanesOf<float>;
+    using State = LadderState<numLanes, float, ladderMaxOrder>;
+
+    template <int fixedIterations, int order>
+    void solveOfOrder (float* const* channelData, int numSamples) noexcept;
+    template <typename Nonlinearity, int fixedIterations, int order>
+    void solve (float* const* channelData, int numSamples) noexcept;
+
+    /** The cutoff setting, limited to maxCutoffRatio of the rate once that is known. */
+    double getLimitedCutoff() const noexcept;
+
+    float* upsample (Channel& channel, const float* input, int stride, int numFrames) noexcept;
+    void downsample (Channel& channel, float* output, int stride, int numFrames) noexcept;
+
+    //==============================================================================
+    std::atomic<double> cutoff { 1000.0 }, feedback { 0.5 }, thermalVoltage { LadderCircuit::thermalVoltage };
+    std::atomic<int> quality { (int) Nonlinearities::Quality::exact };
+    std::atomic<int> oversamplingStages { 2 };
+    std::atomic<int> ladderOrder { 4 };
+    std::atomic<bool> fixedCost { false };
+
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    int activeStages = -1, activeOrder = 4, activeQuality = 0;
+    double stageLatency[maxOversamplingStages] = {}; // in samples at the lower rate of each stage
+
+    LadderParameterRamp cutoffRamp, feedbackRamp, thermalVoltageRamp; // the cutoff in octaves, as the plugin ramps it
+    LadderCoefficients coefficients, targetCoefficients;
+    LadderCoefficientRamp coefficientRamp;
+
+    std::vector<Channel> channels;
+    std::vector<State> states; // one per group of numLanes channels
+};
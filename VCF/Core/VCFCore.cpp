@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    VCFCore.cpp
+
+    The C interface of VCFCore.h over LadderEngine. No exception gets past it.
+
+  ==============================================================================
+*/
+
+#include "VCFCore.h"
+#include "LadderEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+struct vcf_core
+{
+    LadderEngine engine;
+};
+
+//==============================================================================
+vcf_core* vcf_create (void)
+{
+    return new (std::nothrow) vcf_core();
+}
+
+void vcf_destroy (vcf_core* core)
+{
+    delete core;
+}
+
+vcf_result vcf_prepare (vcf_core* core, double sample_rate, int num_channels)
+{
+    if (core == nullptr || ! (sample_rate > 0.0) || num_channels < 1 || num_channels > LadderEngine::maxChannels)
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    try
+    {
+        core->engine.prepare (sample_rate, num_channels);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return VCF_ERROR_OUT_OF_MEMORY;
+    }
+
+    return VCF_OK;
+}
+
+vcf_result vcf_reset (vcf_core* core)
+{
+    if (core == nullptr)
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    core->engine.reset();
+    return VCF_OK;
+}
+
+//==============================================================================
+vcf_result vcf_set_parameter (vcf_core* core, vcf_parameter parameter, double value)
+{
+    if (core == nullptr || std::isnan (value))
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    auto& engine = core->engine;
+
+    // a choice is clamped to its range before it is rounded to an int, so a huge value cannot overflow it
+    auto isChoice = parameter == VCF_PARAMETER_QUALITY || parameter == VCF_PARAMETER_OVERSAMPLING
+                    || parameter == VCF_PARAMETER_ORDER || parameter == VCF_PARAMETER_FIXED_COST;
+
+    if (isChoice && ! std::isfinite (value))
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    auto choice = [value] (int low, int high) { return (int) std::lround (std::clamp (value, (double) low, (double) high)); };
+
+    switch (parameter)
+    {
+        case VCF_PARAMETER_CUTOFF:          engine.setCutoff (value); break;
+        case VCF_PARAMETER_FEEDBACK:        engine.setFeedback (value); break;
+        case VCF_PARAMETER_THERMAL_VOLTAGE: engine.setThermalVoltage (value); break;
+        case VCF_PARAMETER_QUALITY:         engine.setQuality (static_cast<Nonlinearities::Quality> (choice (0, 3))); break;
+        case VCF_PARAMETER_OVERSAMPLING:    engine.setOversamplingStages (choice (0, LadderEngine::maxOversamplingStages)); break;
+        case VCF_PARAMETER_ORDER:           engine.setOrder (choice (2, ladderMaxOrder)); break;
+        case VCF_PARAMETER_FIXED_COST:      engine.setFixedCost (choice (0, 1) != 0); break;
+        default:                            return VCF_ERROR_INVALID_ARGUMENT;
+    }
+
+    return VCF_OK;
+}
+
+double vcf_get_parameter (const vcf_core* core, vcf_parameter parameter)
+{
+    if (core == nullptr)
+        return 0.0;
+
+    auto& engine = core->engine;
+
+    switch (parameter)
+    {
+        case VCF_PARAMETER_CUTOFF:          return engine.getCutoff();
+        case VCF_PARAMETER_FEEDBACK:        return engine.getFeedback();
+        case VCF_PARAMETER_THERMAL_VOLTAGE: return engine.getThermalVoltage();
+        case VCF_PARAMETER_QUALITY:         return (double) engine.getQuality();
+        case VCF_PARAMETER_OVERSAMPLING:    return (double) engine.getOversamplingStages();
+        case VCF_PARAMETER_ORDER:           return (double) engine.getOrder();
+        case VCF_PARAMETER_FIXED_COST:      return engine.getFixedCost() ? 1.0 : 0.0;
+        default:                            return 0.0;
+    }
+}
+
+int vcf_get_latency (const vcf_core* core)
+{
+    return core != nullptr ? core->engine.getLatencySamples() : 0;
+}
+
+//==============================================================================
+vcf_result vcf_process_planar (vcf_core* core, const float* const* input, float* const* output, int num_frames)
+{
+    if (core == nullptr || input == nullptr || output == nullptr || num_frames < 0)
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    if (! core->engine.isPrepared())
+        return VCF_ERROR_NOT_PREPARED;
+
+    for (int channel = 0; channel < core->engine.getNumChannels(); ++channel)
+        if (input[channel] == nullptr || output[channel] == nullptr)
+            return VCF_ERROR_INVALID_ARGUMENT;
+
+    core->engine.process (input, output, 1, num_frames);
+    return VCF_OK;
+}
+
+vcf_result vcf_process_interleaved (vcf_core* core, const float* input, float* output, int num_frames)
+{
+    if (core == nullptr || input == nullptr || output == nullptr || num_frames < 0)
+        return VCF_ERROR_INVALID_ARGUMENT;
+
+    if (! core->engine.isPrepared())
+        return VCF_ERROR_NOT_PREPARED;
+
+    // channel c starts at sample c of the first frame, and the engine steps over whole frames
+    auto numChannels = core->engine.getNumChannels();
+    const float* inputChannels[LadderEngine::maxChannels];
+    float* outputChannels[LadderEngine::maxChannels];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        inputChannels[channel] = input + channel;
+        outputChannels[channel] = output + channel;
+    }
+
+    core->engine.process (inputChannels, outputChannels, numChannels, num_frames);
+    return VCF_OK;
+}
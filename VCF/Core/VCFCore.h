@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    VCFCore.h
+
+    C interface to the ladder filter core, for hosts outside JUCE: render
+    services, game engines, other languages.
+
+    An instance is created, prepared for a sample rate and channel count, fed
+    audio and destroyed. Instances share no state, so any number of them can
+    run on as many threads. One instance is not reentrant: its process,
+    prepare and reset calls must not overlap, but its parameters can be set
+    from any thread while it processes.
+
+  ==============================================================================
+*/
+
+#ifndef VCF_CORE_H
+#define VCF_CORE_H
+
+#if defined (VCF_CORE_SHARED) && defined (_WIN32)
+ #if defined (VCF_CORE_BUILDING)
+  #define VCF_CORE_API __declspec (dllexport)
+ #else
+  #define VCF_CORE_API __declspec (dllimport)
+ #endif
+#elif defined (VCF_CORE_SHARED) && defined (__GNUC__)
+ #define VCF_CORE_API __attribute__ ((visibility ("default")))
+#else
+ #define VCF_CORE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vcf_core vcf_core;
+
+typedef enum vcf_result
+{
+    VCF_OK = 0,
+    VCF_ERROR_INVALID_ARGUMENT = -1,   /* a null pointer, a count out of range, a NaN or an infinite choice */
+    VCF_ERROR_NOT_PREPARED = -2,       /* processed before vcf_prepare succeeded */
+    VCF_ERROR_OUT_OF_MEMORY = -3
+} vcf_result;
+
+/* Values out of range are clamped to it, and choices rounded to the nearest one; the defaults are the plugin's. */
+typedef enum vcf_parameter
+{
+    VCF_PARAMETER_CUTOFF = 0,          /* Hz, from 1 to 0.45 times the sample rate (default 1000) */
+    VCF_PARAMETER_FEEDBACK,            /* resonance feedback gain K, 0 to 4 (default 0.5) */
+    VCF_PARAMETER_THERMAL_VOLTAGE,     /* Vt in volts, 0.0001 to 0.05 (default 0.026) */
+    VCF_PARAMETER_QUALITY,             /* tanh: 0 exact, 1 Pade, 2 table, 3 antialiased (default 0) */
+    VCF_PARAMETER_OVERSAMPLING,        /* 2x stages, 0 (1x) to 4 (16x) (default 2) */
+    VCF_PARAMETER_ORDER,               /* poles, 2, 4, 6 or 8 (default 4) */
+    VCF_PARAMETER_FIXED_COST           /* 0 iterates to convergence, 1 takes a fixed number of steps (default 0) */
+} vcf_parameter;
+
+/* Returns a new instance with the default parameters, or NULL if out of memory. */
+VCF_CORE_API vcf_core* vcf_create (void);
+
+/* Frees an instance; NULL is ignored. */
+VCF_CORE_API void vcf_destroy (vcf_core* core);
+
+/* Allocates everything for a sample rate and 1 to 16 channels, and resets.
+   Processing never allocates after this. */
+VCF_CORE_API vcf_result vcf_prepare (vcf_core* core, double sample_rate, int num_channels);
+
+/* Clears the filter states, e.g. between unrelated files. */
+VCF_CORE_API vcf_result vcf_reset (vcf_core* core);
+
+/* Cutoff, feedback and Vt ramp to the new value over 20 ms; the rest apply on the next process call. */
+VCF_CORE_API vcf_result vcf_set_parameter (vcf_core* core, vcf_parameter parameter, double value);
+VCF_CORE_API double vcf_get_parameter (const vcf_core* core, vcf_parameter parameter);
+
+/* Latency of the current oversampling setting, in samples. */
+VCF_CORE_API int vcf_get_latency (const vcf_core* core);
+
+/* Filters num_frames samples of every channel; input[c] and output[c] point to channel c.
+   Processes in place when output is input, channel by channel. */
+VCF_CORE_API vcf_result vcf_process_planar (vcf_core* core, const float* const* input, float* const* output, int num_frames);
+
+/* Filters num_frames frames of interleaved channels. Processes in place when output is input. */
+VCF_CORE_API vcf_result vcf_process_interleaved (vcf_core* core, const float* input, float* output, int num_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VCF_CORE_H */
@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    CutoffTable.h
+
+    Table-based mapping from a cutoff in octaves to the solver's integrator
+    gain, for cutoff modulation at the solver rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+//==============================================================================
+/**
+    The solver's integrator gain is a = T I0 / (4 C) = 4 Vt tan (pi f0 / Fs),
+    which makes a cutoff that moves every sample cost a tan every sample.
+
+    This table holds tan (pi u) over the log2 of the normalised cutoff
+    u = f0 / Fs, so a cutoff given in octaves (a base pitch plus a CV times
+    a depth) turns into one clamp and one linearly interpolated lookup. The
+    spacing in octaves keeps the relative error below 4.1e-6 up to a quarter
+    of the rate; it grows to 1.7e-4 at 0.45 of the rate, where the cutoff is
+    clamped.
+
+    The lookup is plain branch-free arithmetic, so loops over a block of CV
+    samples vectorise apart from the gather.
+*/
+struct CutoffTable
+{
+    static constexpr int tableSize = 4096;
+    static constexpr double minOctave = -18.0;               // 2^-18 of the solver rate
+    static constexpr double maxOctave = -1.1520030934450500; // log2 (0.45)
+
+    /** Returns tan (pi f0 / Fs), for f0 / Fs = 2^octave clamped to the table range. */
+    static double tanOfOctave (double octave) noexcept
+    {
+        constexpr auto scale = (tableSize - 1) / (maxOctave - minOctave);
+
+        octave = octave < minOctave ? minOctave : (octave > maxOctave ? maxOctave : octave);
+
+        const auto position = (octave - minOctave) * scale;
+        auto index = (int) position;
+        index = index > tableSize - 2 ? tableSize - 2 : index;
+        const auto fraction = position - (double) index;
+
+        return table.values[index] + fraction * (table.values[index + 1] - table.values[index]);
+    }
+
+private:
+    struct Table
+    {
+        Table()
+        {
+            // 3.14 rather than pi, to match LadderCircuit::getBiasCurrent
+            for (int i = 0; i < tableSize; ++i)
+                values[i] = std::tan (3.14 * std::exp2 (minOctave + (maxOctave - minOctave) * i / (tableSize - 1)));
+        }
+
+        double values[tableSize];
+    };
+
+    static const Table table;
+};
+
+inline const CutoffTable::Table CutoffTable::table;
@@ -0,0 +1,863 @@
+/*
+  ==============================================================================
+
+    LadderSolver.h
+
+    Newton-Raphson solver for the four-stage transistor ladder, discretised
+    with the trapezoidal rule.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include "LadderVector.h"
+#include "Nonlinearities.h"
+
+/** Newton iterations a LadderSolver takes per sample at most. */
+static constexpr int ladderMaxIterations = 8;
+
+/** Newton iterations the fixed-cost solver takes on every sample. */
+static constexpr int ladderFixedIterations = 2;
+
+/** Most stages a ladder can be instantiated with. */
+static constexpr int ladderMaxOrder = 8;
+
+//==============================================================================
+/**
+    Ladder state of numLanes channels in structure-of-arrays layout, so that
+    the same stage of every channel sits in one contiguous vector. Type is the
+    precision the solver runs in for these channels.
+
+    A state with numStages stages can hold a ladder of any order up to that;
+    the solver only touches the stages its own order uses.
+*/
+template <int numLanes, typename Type = double, int maxStages = 4>
+struct LadderState
+{
+    static constexpr int numStages = maxStages;
+    static constexpr int numArguments = numStages + 1; // tanh evaluations per solve
+
+    using Vector = LadderVector<Type, numLanes>;
+
+    /** Clears the capacitor voltages and integrator states of every lane. */
+    void reset() noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+            reset (lane);
+    }
+
+    /** Clears a single lane, leaving the other channels untouched. */
+    void reset (int lane) noexcept
+    {
+        for (int i = 0; i < numStages; ++i)
+            vc[i][lane] = vcPast[0][i][lane] = vcPast[1][i][lane] = s[i][lane] = 0;
+
+        for (int i = 0; i < numArguments; ++i)
+            argumentsPast[i][lane] = 0;
+    }
+
+    /** Clears stage firstStage and every stage after it in all lanes, e.g. the ones a change of order leaves stale. */
+    void resetStagesFrom (int firstStage) noexcept
+    {
+        for (int i = firstStage; i < numStages; ++i)
+            for (int lane = 0; lane < numLanes; ++lane)
+                vc[i][lane] = vcPast[0][i][lane] = vcPast[1][i][lane] = s[i][lane] = 0;
+
+        for (int i = firstStage; i < numArguments; ++i)
+            for (int lane = 0; lane < numLanes; ++lane)
+                argumentsPast[i][lane] = 0;
+    }
+
+    /** Returns the largest capacitor voltage or integrator state of any lane. */
+    Type getPeak() const noexcept
+    {
+        Type peak = 0;
+
+        for (int i = 0; i < numStages; ++i)
+            for (int lane = 0; lane < numLanes; ++lane)
+                peak = std::fmax (peak, std::fmax (std::abs (vc[i][lane]), std::abs (s[i][lane])));
+
+        return peak;
+    }
+
+    /** Returns the largest capacitor voltage or integrator state of a single lane. */
+    Type getPeak (int lane) const noexcept
+    {
+        Type peak = 0;
+
+        for (int i = 0; i < numStages; ++i)
+            peak = std::fmax (peak, std::fmax (std::abs (vc[i][lane]), std::abs (s[i][lane])));
+
+        return peak;
+    }
+
+    /** True if every capacitor voltage and integrator state of every lane is below threshold. */
+    bool isBelow (double threshold) const noexcept
+    {
+        return getPeak() < (Type) threshold;
+    }
+
+    /** Sets one lane to a lane of another state, which may have a different number of lanes. */
+    template <int otherLanes>
+    void copyLane (int lane, const LadderState<otherLanes, Type, maxStages>& other, int otherLane) noexcept
+    {
+        for (int i = 0; i < numStages; ++i)
+        {
+            vc[i][lane] = other.vc[i][otherLane];
+            vcPast[0][i][lane] = other.vcPast[0][i][otherLane];
+            vcPast[1][i][lane] = other.vcPast[1][i][otherLane];
+            s[i][lane] = other.s[i][otherLane];
+        }
+
+        for (int i = 0; i < numArguments; ++i)
+            argumentsPast[i][lane] = other.argumentsPast[i][otherLane];
+    }
+
+    /** True if everything the solver keeps for lanes 1 to numLanesToCompare - 1 is within tolerance of lane 0. */
+    bool lanesMatch (int numLanesToCompare, double tolerance) const noexcept
+    {
+        Type difference = 0;
+
+        for (int lane = 1; lane < numLanesToCompare; ++lane)
+        {
+            for (int i = 0; i < numStages; ++i)
+            {
+                difference = std::fmax (difference, std::fmax (std::abs (vc[i][lane] - vc[i][0]), std::abs (s[i][lane] - s[i][0])));
+                difference = std::fmax (difference, std::fmax (std::abs (vcPast[0][i][lane] - vcPast[0][i][0]),
+                                                               std::abs (vcPast[1][i][lane] - vcPast[1][i][0])));
+            }
+
+            for (int i = 0; i < numArguments; ++i)
+                difference = std::fmax (difference, std::abs (argumentsPast[i][lane] - argumentsPast[i][0]));
+        }
+
+        return difference <= (Type) tolerance;
+    }
+
+    /** Stores the capacitor voltages every lane settled on for this sample, and advances the integrators. */
+    template <int order>
+    void store (const Vector (&v)[order]) noexcept
+    {
+        static_assert (order <= numStages, "the state holds fewer stages than the ladder");
+
+        for (int i = 0; i < order; ++i)
+        {
+            // trapezoidal state update: s = T/2 xc + vc with T/2 xc = vc - s
+            (Vector ((Type) 2) * v[i] - Vector::load (s[i])).store (s[i]);
+
+            Vector::load (vcPast[0][i]).store (vcPast[1][i]);
+            Vector::load (vc[i]).store (vcPast[0][i]);
+            v[i].store (vc[i]);
+        }
+    }
+
+    /** Stores the tanh arguments of the settled solution, which an antialiased Nonlinearity starts the next sample from. */
+    template <int order>
+    void storeArguments (const Vector (&x)[order + 1]) noexcept
+    {
+        for (int i = 0; i <= order; ++i)
+            x[i].store (argumentsPast[i]);
+    }
+
+    alignas (64) Type vc[numStages][numLanes];
+    alignas (64) Type vcPast[2][numStages][numLanes]; // vc one and two samples before, for the predictor
+    alignas (64) Type s[numStages][numLanes];
+    alignas (64) Type argumentsPast[numArguments][numLanes]; // tanh arguments of the previous sample
+};
+
+//==============================================================================
+/** How the solver builds its initial guess from the last three solutions. */
+enum class LadderPredictor
+{
+    previous = 0,   // start from the previous sample's solution
+    linear,         // extrapolate the last two solutions
+    quadratic       // extrapolate the last three solutions
+};
+
+//==============================================================================
+/** Which response the solver outputs, mixed from the input and the stage voltages. */
+enum class LadderResponse
+{
+    lowpass = 0,    // the last stage, the circuit's own output
+    highpass,       // the input pair's drive with the lowpass parts of the stages taken out
+    bandpass        // the stages alone, with half the zeros at DC and half at infinity
+};
+
+/**
+    The weights of the stage voltages vc1..vcN in the highpass and bandpass
+    mixes, a row per order from 2 to ladderMaxOrder.
+
+    Linearised, and with p the Laplace variable over I0 / (4 C gamma),
+    the stages of a ladder of order N driven by the input pair's e = vin - vout follow
+
+        p vc1 = (gamma / Vt) e + vc2 - vc1
+        p vci = vc(i+1) - 2 vci + vc(i-1)       for 1 < i < N
+        p vcN = vc(N-1) - 4/3 vcN
+
+    so every vci is (gamma / Vt) e times a polynomial in p of degree N - i over
+    the same denominator D(p) of degree N. A mix of e and the vci can then have
+    any numerator of degree up to N. Open loop, the highpass row, with e at weight one,
+    leaves p^N / D(p), and the bandpass row p^(N/2) / D(p), scaled to a peak of
+    one; the feedback then moves the poles of all three responses alike. The
+    zeros stay exact in the trapezoidal solver, whose bilinear mapping keeps
+    them at DC.
+
+    The poles of D spread over a wide range, the more so the higher the
+    order: the lowpass of four stages falls 3 dB at p = 0.0625, the highpass
+    at p = 4.46, and the bandpass peaks at p = 1.10 in between. The weights grow with
+    the order and cancel each other below the passband, which brings out the
+    rounding of the stage voltages: in a float ladder the mixes carry errors of
+    2e-5 of the stage peak at four stages and 2e-3 at eight, against 1e-4 at
+    eight in a double ladder.
+*/
+struct LadderTaps
+{
+    static constexpr double highpass[ladderMaxOrder / 2][ladderMaxOrder] =
+    {
+        { -7.0 / 3.0, 25.0 / 9.0 },
+        { -19.0 / 3.0, 199.0 / 9.0, -898.0 / 27.0, 1606.0 / 81.0 },
+        { -31.0 / 3.0, 517.0 / 9.0, -4582.0 / 27.0, 25585.0 / 81.0, -87826.0 / 243.0, 137089.0 / 729.0 },
+        { -43.0 / 3.0, 979.0 / 9.0, -12730.0 / 27.0, 112240.0 / 81.0, -700864.0 / 243.0, 3109324.0 / 729.0,
+          -9247816.0 / 2187.0, 13403950.0 / 6561.0 }
+    };
+
+    static constexpr double bandpass[ladderMaxOrder / 2][ladderMaxOrder] =
+    {
+        { 2.3333333333333339, -3.1111111111111116 },
+        { 0.0, 10.292833390067269, -34.309444633557561, 28.591203861297966 },
+        { 0.0, 0.0, 43.234588839228664, -230.58447380921953, 451.56126120972164, -304.24340294272025 },
+        { 0.0, 0.0, 0.0, 179.49268550512457, -1316.2796937042467, 3968.782712835532,
+          -5969.7937623556245, 3558.8302829781487 }
+    };
+};
+
+//==============================================================================
+/** Circuit constants of the ladder, precomputed into the form the solver uses. */
+struct LadderCoefficients
+{
+    /** Sets the circuit constants.
+
+        @param I0         bias current, sets the cutoff
+        @param C          stage capacitance
+        @param T          sampling period the solver runs at
+        @param Vt         thermal voltage of the input pair
+        @param gamma      eta * Vt of the ladder stages
+        @param feedback   resonance feedback gain K
+        @param tolerance  relative step size at which the iteration stops
+    */
+    void set (double I0, double C, double T, double Vt, double gamma,
+              double feedback, double tolerance) noexcept
+    {
+        a = T * I0 / (4.0 * C);
+        inputScale = 1.0 / (2.0 * Vt);
+        stageScale = 1.0 / (2.0 * gamma);
+        lastStageScale = 1.0 / (6.0 * gamma);
+        outputGain = 0.5 + feedback;
+        err = tolerance;
+    }
+
+    /** Sets the extrapolation the initial guess of each sample is built with. */
+    void setPredictor (LadderPredictor predictor) noexcept
+    {
+        switch (predictor)
+        {
+            case LadderPredictor::linear:     predict[0] = 2.0; predict[1] = -1.0; predict[2] = 0.0; break;
+            case LadderPredictor::quadratic:  predict[0] = 3.0; predict[1] = -3.0; predict[2] = 1.0; break;
+            case LadderPredictor::previous:
+            default:                          predict[0] = 1.0; predict[1] =  0.0; predict[2] = 0.0; break;
+        }
+    }
+
+    double a = 0.0, inputScale = 0.0, stageScale = 0.0, lastStageScale = 0.0;
+    double outputGain = 0.5, err = 1.0e-3;
+    double predict[3] = { 1.0, 0.0, 0.0 }; // weights of vc, vcPast[0] and vcPast[1] in the initial guess
+};
+
+//==============================================================================
+/**
+    Component values of the modelled circuit, and the mapping from the plugin's
+    controls to its bias current. VCFAudioProcessor and the JUCE-free core
+    library both build their coefficients from here, so they sound the same.
+*/
+namespace LadderCircuit
+{
+    static constexpr double capacitance = 0.01e-6;  // C of every stage
+    static constexpr double thermalVoltage = 0.026; // Vt of the input pair
+    static constexpr double minControlVoltage = 1.0e-4; // lowest ControlVt; zero would make gamma zero and freeze the ladder
+    static constexpr double eta = 1.836;            // the stages' gamma is eta times ControlVt
+    static constexpr double tolerance = 10e-4;      // relative step size at which the iteration stops
+
+    /** The bias current I0 that puts the cutoff of a ladder sampled at rate at f0, for a ControlVt of vt. */
+    inline double getBiasCurrent (double f0, double vt, double rate) noexcept
+    {
+        // 3.14 rather than pi, as the control has always mapped (CutoffTable follows it too)
+        return 2.0 * rate * std::tan (2.0 * 3.14 * f0 / rate / 2.0) * 8.0 * capacitance * vt;
+    }
+
+    /** Sets the constants for cutoff f0, feedback k and ControlVt vt, for a solver running at rate. */
+    inline void setCoefficients (LadderCoefficients& coefficients, double f0, double k, double vt, double rate,
+                                 double relativeTolerance = tolerance) noexcept
+    {
+        coefficients.set (getBiasCurrent (f0, vt, rate), capacitance, 1.0 / rate, thermalVoltage, eta * vt, k, relativeTolerance);
+    }
+}
+
+//==============================================================================
+/**
+    Per-sample increments that take one LadderCoefficients linearly into
+    another. Ramping the solver's own constants means a parameter change costs
+    a handful of additions per sample, instead of the tan and the divisions
+    behind LadderCoefficients::set().
+*/
+struct LadderCoefficientRamp
+{
+    /** Sets up a ramp from one set of constants to another over numSamples samples. */
+    void set (const LadderCoefficients& from, const LadderCoefficients& to, int numSamples) noexcept
+    {
+        const auto scale = numSamples > 0 ? 1.0 / numSamples : 0.0;
+
+        a = (to.a - from.a) * scale;
+        inputScale = (to.inputScale - from.inputScale) * scale;
+        stageScale = (to.stageScale - from.stageScale) * scale;
+        lastStageScale = (to.lastStageScale - from.lastStageScale) * scale;
+        outputGain = (to.outputGain - from.outputGain) * scale;
+
+        active = numSamples > 0 && (a != 0.0 || inputScale != 0.0 || stageScale != 0.0
+                                     || lastStageScale != 0.0 || outputGain != 0.0);
+    }
+
+    /** Advances the constants by one sample. */
+    void apply (LadderCoefficients& coefficients) const noexcept
+    {
+        coefficients.a += a;
+        coefficients.inputScale += inputScale;
+        coefficients.stageScale += stageScale;
+        coefficients.lastStageScale += lastStageScale;
+        coefficients.outputGain += outputGain;
+    }
+
+    double a = 0.0, inputScale = 0.0, stageScale = 0.0, lastStageScale = 0.0, outputGain = 0.0;
+    bool active = false;
+};
+
+//==============================================================================
+/**
+    A control moving linearly to its target over a set number of samples,
+    advanced a sub-block at a time. VCFAudioProcessor and LadderEngine both
+    ramp the feedback and ControlVt with it, and the cutoff in octaves, and
+    evaluate it at the end of each sub-block before setting the coefficients
+    from LadderCircuit.
+*/
+struct LadderParameterRamp
+{
+    /** Jumps straight to a value, with nothing left to ramp. */
+    void reset (double value) noexcept                  { current = target = value; remaining = 0; }
+
+    /** Starts a ramp from the current value to a new target; the same target again leaves a running ramp alone. */
+    void setTarget (double value, int rampSamples) noexcept
+    {
+        if (value != target)
+        {
+            target = value;
+            remaining = rampSamples;
+
+            if (remaining <= 0)
+                current = target;
+        }
+    }
+
+    /** Moves on by numSamples and returns the value there. */
+    double skip (int numSamples) noexcept
+    {
+        if (numSamples >= remaining)
+        {
+            current = target;
+            remaining = 0;
+        }
+        else
+        {
+            current += (target - current) * numSamples / remaining;
+            remaining -= numSamples;
+        }
+
+        return current;
+    }
+
+    double current = 0.0, target = 0.0;
+    int remaining = 0;
+};
+
+//==============================================================================
+/**
+    Elimination of the ladder's Newton matrix, shared by LadderSolver and
+    LinearLadderSolver, for one matrix per lane of a LadderVector.
+
+    For a ladder of order N the matrix is tridiagonal and symmetric, with the
+    slopes d1..d(N-1) of the stage tanh on the off-diagonals, plus the
+    feedback entry d0 G in the top right corner:
+
+        row 1       1 + d1              -d1                  ...  d0 G
+        row i       -d(i-1)   1 + d(i-1) + di   -di
+        row N                 -d(N-1)            1 + d(N-1) + dN
+
+    factor() runs the forward elimination on the matrix, carrying the corner
+    entry down its column; solve() applies the same row operations to a
+    right-hand side and back-substitutes. The diagonal never drops below one,
+    so the elimination needs no pivoting.
+
+    Every entry is a LadderVector, so each row operation is one instruction for
+    all the lanes of a register, with the same arithmetic per lane as a single
+    matrix.
+*/
+template <typename Vector, int order>
+struct LadderElimination
+{
+    static_assert (order >= 2 && order <= ladderMaxOrder, "unsupported ladder order");
+
+    using Type = typename Vector::ValueType;
+
+    /** Factors the matrices with slopes d[0..order], already scaled by a, and feedback gain G. */
+    void factor (const Vector (&d)[order + 1], Vector feedbackGain) noexcept
+    {
+        const Vector zero ((Type) 0), one ((Type) 1);
+
+        for (int i = 0; i < order; ++i)
+        {
+            diagonal[i] = (i > 0 ? one + d[i] : one) + (i < order - 1 ? d[i + 1] : d[order]);
+            upper[i] = i < order - 1 ? -d[i + 1] : zero;
+            corner[i] = zero;
+        }
+
+        // the top right entry, which is the upper diagonal itself for a two-pole ladder
+        if (order == 2)
+            upper[0] += d[0] * feedbackGain;
+        else
+            corner[0] = d[0] * feedbackGain;
+
+        for (int i = 0; i < order - 1; ++i)
+        {
+            multiplier[i] = -d[i + 1] / diagonal[i];
+            diagonal[i + 1] -= multiplier[i] * upper[i];
+
+            if (i + 1 < order - 2)
+                corner[i + 1] = -multiplier[i] * corner[i];
+            else if (i + 1 == order - 2)
+                upper[i + 1] -= multiplier[i] * corner[i];
+        }
+
+        for (int i = 0; i < order; ++i)
+            inverse[i] = one / diagonal[i];
+    }
+
+    /** Solves the factored systems for the right-hand sides r, which are overwritten, into x. */
+    void solve (Vector (&r)[order], Vector (&x)[order]) const noexcept
+    {
+        for (int i = 0; i < order - 1; ++i)
+            r[i + 1] -= multiplier[i] * r[i];
+
+        x[order - 1] = r[order - 1] * inverse[order - 1];
+        x[order - 2] = (r[order - 2] - upper[order - 2] * x[order - 1]) * inverse[order - 2];
+
+        for (int i = order - 3; i >= 0; --i)
+            x[i] = (r[i] - upper[i] * x[i + 1] - corner[i] * x[order - 1]) * inverse[i];
+    }
+
+    Vector diagonal[order], upper[order], corner[order], multiplier[order], inverse[order];
+};
+
+//==============================================================================
+/**
+    Solves the implicit trapezoidal ladder equations once per sample, for
+    numLanes independent channels at a time.
+
+    With a = T * I0 / (4 C) the capacitor voltages vc1..vcN of a ladder of
+    order N have to satisfy
+
+        F1 = vc1 - a (u0 + u1) - s1 = 0
+        Fi = vci - a (ui - u(i-1)) - si = 0         for 1 < i < N
+        FN = vcN + a (uN + u(N-1)) - sN = 0
+
+    where u0 = tanh ((vin - vout) / 2Vt), u1..u(N-1) are the tanh of the voltage
+    across each stage over 2 gamma, uN = tanh (vcN / 6 gamma) and
+    vout = vcN (1/2 + K). The four-stage ladder is the Moog circuit; the other
+    orders stack the same stage, which moves the resonance and steepens or
+    flattens the slope. The stages load each other in both directions rather
+    than forming a buffered one-pole cascade. The output is the lowpass at the
+    last stage, or with response set otherwise a mix of the input and the
+    stages (see LadderTaps); the feedback always takes the lowpass.
+
+    The Jacobian of that system is tridiagonal apart from the feedback term
+    dF1/dvcN, so each Newton step is a branch-free elimination (see
+    LadderElimination) using the same N + 1 tanh values the residual needed.
+    The loops over the stages have compile-time bounds, so they unroll into the
+    same straight-line code a hand-written ladder of that order would be.
+
+    Each sample starts from an extrapolation of the last solutions (see
+    LadderPredictor), which for audio-band signals at oversampled rates is
+    usually within the tolerance after one or two steps.
+
+    Every lane quantity is a LadderVector holding all numLanes channels, so
+    each step of the iteration, from the arguments through the elimination to
+    the step size, is written once and runs a register at a time, and numLanes
+    channels cost about what one does: with PadeTanh and AVX2, four double
+    lanes measure 110 ns a sample and eight float lanes 108 ns, against 106 ns
+    for a single double lane. The lanes share one convergence test:
+    a single compare over the register, after which the iteration stops once
+    every lane passed; lanes that converged earlier simply take another (tiny)
+    Newton step.
+
+    The tanh evaluations go through the Nonlinearity policy (see
+    Nonlinearities.h): a vectorised one on the whole register, the others one
+    lane at a time; the rest of the step stays in registers either way. An
+    antialiased policy replaces each tanh by its mean since the previous
+    sample; the Jacobian then uses the slopes the policy reports. Every
+    solve keeps its settled arguments in the state, whichever policy ran, so
+    a switch to the antialiased one, by the user or by the quality governor,
+    starts on the segment from the last sample actually played.
+
+    The coefficients are kept in double precision and rounded to Type once per
+    sample; everything per lane runs in Type, so a float solver never converts
+    inside the lane loop.
+
+    The iteration count is capped at maxIterations. A lane that has not
+    converged by then keeps its last iterate; one that produced a non-finite
+    value falls back to the previous sample's solution, so the worst case cost
+    is always maxIterations evaluations.
+
+    With fixedIterations above zero every sample takes exactly that many steps
+    and skips the convergence test, so each sample costs the same, for hosts
+    that budget for the worst case rather than the average. Starting from the
+    quadratic predictor, two steps stay within 1.5e-5 of the converged output
+    (relative to its peak) on full-scale noise at the host rate with K = 3.9,
+    and within 6e-8 at 4x oversampling; converged then only reports the
+    non-finite fallback.
+*/
+template <typename Nonlinearity, int numLanes, typename Type = double, int fixedIterations = 0, int order = 4,
+          LadderResponse response = LadderResponse::lowpass>
+struct LadderSolver
+{
+    static_assert (fixedIterations >= 0 && fixedIterations <= ladderMaxIterations, "at most ladderMaxIterations steps");
+
+    static constexpr int numStages = order;
+    static constexpr int maxIterations = fixedIterations > 0 ? fixedIterations : ladderMaxIterations;
+    static constexpr int tanhPerIteration = order + 1; // per lane
+
+    using Vector = LadderVector<Type, numLanes>;
+
+    /** Runs one sample of every lane through the ladder.
+
+        @param coefficients  circuit constants shared by all lanes
+        @param state         ladder state, advanced by one sample
+        @param vin           numLanes input samples, one per channel
+        @param vout          receives numLanes output samples
+        @param converged     set to false if a lane hit maxIterations or had to fall back
+        @returns             the number of Newton iterations taken
+    */
+    template <int stateStages>
+    static int processSample (const LadderCoefficients& coefficients, LadderState<numLanes, Type, stateStages>& state,
+                              const Type* vin, Type* vout, bool& converged) noexcept
+    {
+        alignas (64) Type a[numLanes];
+
+        for (int l = 0; l < numLanes; ++l)
+            a[l] = (Type) coefficients.a;
+
+        return processSample (coefficients, a, state, vin, vout, converged);
+    }
+
+    /** Runs one sample of every lane through the ladder, each lane with its own
+        integrator gain a in place of coefficients.a, e.g. voices tuned to different notes.
+    */
+    template <int stateStages>
+    static int processSample (const LadderCoefficients& coefficients, const Type* laneA,
+                              LadderState<numLanes, Type, stateStages>& state,
+                              const Type* vin, Type* vout, bool& converged) noexcept
+    {
+        static_assert (order <= stateStages, "the state holds fewer stages than the ladder");
+
+        const Vector outputGain ((Type) coefficients.outputGain);
+        const Vector err ((Type) coefficients.err), absoluteError ((Type) absoluteTolerance);
+        const Vector p0 ((Type) coefficients.predict[0]), p1 ((Type) coefficients.predict[1]), p2 ((Type) coefficients.predict[2]);
+
+        const auto a = Vector::load (laneA), input = Vector::load (vin);
+        const auto inputSlope = a * Vector ((Type) coefficients.inputScale);
+        const auto stageSlope = a * Vector ((Type) coefficients.stageScale);
+        const auto lastStageSlope = a * Vector ((Type) coefficients.lastStageScale);
+
+        Vector v[order], s[order], x[order + 1], u[order + 1], d[order + 1], r[order], dv[order];
+        Vector step, scale;
+
+        // an antialiased tanh needs the antiderivative at the last sample's arguments, which stays fixed while iterating
+        alignas (64) Type antiderivativesPast[order + 1][numLanes];
+
+        if constexpr (Nonlinearity::antialiased)
+            for (int i = 0; i <= order; ++i)
+                for (int l = 0; l < numLanes; ++l)
+                    antiderivativesPast[i][l] = Nonlinearity::antiderivative (state.argumentsPast[i][l]);
+
+        for (int i = 0; i < order; ++i)
+        {
+            s[i] = Vector::load (state.s[i]);
+            v[i] = p0 * Vector::load (state.vc[i]) + p1 * Vector::load (state.vcPast[0][i]) + p2 * Vector::load (state.vcPast[1][i]);
+        }
+
+        int iteration = 0;
+        converged = false;
+
+        while (iteration < maxIterations && (fixedIterations > 0 || ! converged))
+        {
+            ++iteration;
+
+            // the tanh and their slopes, scaled by a
+            getArguments (coefficients, v, input, x);
+
+            for (int i = 0; i <= order; ++i)
+                evaluate (x[i], state.argumentsPast[i], antiderivativesPast[i], u[i], d[i]);
+
+            d[0] *= inputSlope;
+            d[order] *= lastStageSlope;
+
+            for (int i = 1; i < order; ++i)
+                d[i] *= stageSlope;
+
+            // residuals
+            r[0] = v[0] - a * (u[0] + u[1]) - s[0];
+            r[order - 1] = v[order - 1] + a * (u[order] + u[order - 1]) - s[order - 1];
+
+            for (int i = 1; i < order - 1; ++i)
+                r[i] = v[i] - a * (u[i + 1] - u[i]) - s[i];
+
+            LadderElimination<Vector, order> jacobian;
+            jacobian.factor (d, outputGain);
+            jacobian.solve (r, dv);
+
+            scale = step = Vector ((Type) 0);
+
+            for (int i = 0; i < order; ++i)
+            {
+                v[i] -= dv[i];
+                scale += abs (v[i]);
+                step += abs (dv[i]);
+            }
+
+            // one compare over the register for all lanes, rather than a branch per lane
+            converged = allLessEqual (step, scale * err + absoluteError);
+        }
+
+        // a fixed step count is the intended stopping point, not a failure to converge
+        if (fixedIterations > 0)
+            converged = true;
+
+        // a lane that went non-finite (which fails the compare, NaN included) falls back to the last solution
+        if (! allLessEqual (abs (scale), Vector (std::numeric_limits<Type>::max())))
+        {
+            alignas (64) Type scales[numLanes], lanes[numLanes];
+            scale.store (scales);
+
+            for (int i = 0; i < order; ++i)
+            {
+                v[i].store (lanes);
+
+                for (int l = 0; l < numLanes; ++l)
+                    if (! (std::abs (scales[l]) <= std::numeric_limits<Type>::max()))
+                        lanes[l] = state.vc[i][l];
+
+                v[i] = Vector::load (lanes);
+            }
+
+            converged = false;
+        }
+
+        getOutput (coefficients, v, input).store (vout);
+
+        state.store (v);
+
+        getArguments (coefficients, v, input, x);
+        state.template storeArguments<order> (x);
+
+        return iteration;
+    }
+
+    /** Fills in the tanh arguments of every lane for the given capacitor voltages. */
+    static void getArguments (const LadderCoefficients& coefficients, const Vector (&v)[order],
+                              Vector input, Vector (&x)[order + 1]) noexcept
+    {
+        const Vector inputScale ((Type) coefficients.inputScale);
+        const Vector stageScale ((Type) coefficients.stageScale);
+        const Vector lastStageScale ((Type) coefficients.lastStageScale);
+        const Vector outputGain ((Type) coefficients.outputGain);
+
+        x[0] = (input - outputGain * v[order - 1]) * inputScale;
+        x[order] = v[order - 1] * lastStageScale;
+
+        for (int i = 1; i < order; ++i)
+            x[i] = (v[i] - v[i - 1]) * stageScale;
+    }
+
+    /** The output of every lane for the given capacitor voltages, in the solver's response. */
+    static Vector getOutput (const LadderCoefficients& coefficients, const Vector (&v)[order], Vector input) noexcept
+    {
+        const auto lowpass = Vector ((Type) coefficients.outputGain) * v[order - 1];
+
+        if constexpr (response == LadderResponse::lowpass)
+        {
+            return lowpass;
+        }
+        else
+        {
+            // the taps weigh stages that carry gamma / Vt times the input pair's drive
+            const auto* taps = response == LadderResponse::highpass ? LadderTaps::highpass[order / 2 - 1]
+                                                                   : LadderTaps::bandpass[order / 2 - 1];
+            auto mix = Vector ((Type) taps[0]) * v[0];
+
+            for (int i = 1; i < order; ++i)
+                mix += Vector ((Type) taps[i]) * v[i];
+
+            mix *= Vector ((Type) (coefficients.stageScale / coefficients.inputScale));
+
+            if constexpr (response == LadderResponse::highpass)
+                mix += input - lowpass;
+
+            return mix;
+        }
+    }
+
+    /** One of the tanh through the policy in every lane, with its slopes. */
+    static void evaluate (Vector x, const Type (&argumentsPast)[numLanes], const Type (&antiderivativesPast)[numLanes],
+                          Vector& y, Vector& slope) noexcept
+    {
+        if constexpr (Nonlinearity::vectorised)
+        {
+            y = Nonlinearity::process (x);
+            slope = Vector ((Type) 1) - y * y;
+        }
+        else
+        {
+            alignas (64) Type arguments[numLanes], values[numLanes], slopes[numLanes];
+            x.store (arguments);
+
+            if constexpr (Nonlinearity::antialiased)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                    values[l] = Nonlinearity::process (arguments[l], argumentsPast[l], antiderivativesPast[l], slopes[l]);
+
+                y = Vector::load (values);
+                slope = Vector::load (slopes);
+            }
+            else
+            {
+                for (int l = 0; l < numLanes; ++l)
+                    values[l] = Nonlinearity::process (arguments[l]);
+
+                y = Vector::load (values);
+                slope = Vector ((Type) 1) - y * y;
+            }
+        }
+    }
+
+    static constexpr double absoluteTolerance = 1.0e-9;
+};
+
+//==============================================================================
+/**
+    The same ladder with every tanh replaced by its argument, which is what
+    LadderSolver converges to for small signals.
+
+    Linearised, the implicit equations become a fixed linear system whose
+    matrix is exactly the Newton Jacobian at the origin, with slopes
+    g0 = a / 2Vt, g = a / 2 gamma between the stages and g4 = a / 6 gamma at
+    the last one. For four stages:
+
+        (1 + g) vc1 - g vc2 + g0 G vc4       = s1 + g0 vin
+        -g vc1 + (1 + 2g) vc2 - g vc3        = s2
+        -g vc2 + (1 + 2g) vc3 - g vc4        = s3
+        -g vc3 + (1 + g + g4) vc4            = s4
+
+    with G = 1/2 + K. It is solved in closed form by the same elimination,
+    without iterating, for all lanes at once: one factorisation and one
+    substitution a sample, each a register wide.
+
+    The state is shared with LadderSolver, so a channel can move between the
+    two from one sample to the next.
+*/
+template <int numLanes, typename Type = double, int order = 4, LadderResponse response = LadderResponse::lowpass>
+struct LinearLadderSolver
+{
+    /** Largest relative error the linear ladder may make in any one tanh. */
+    static constexpr double maxLinearisationError = 1.0e-3;
+
+    /** Largest estimated drive at which the linear ladder stands in for the nonlinear one.
+        tanh (x) / x = 1 - x^2 / 3 + ..., so this is sqrt (3 maxLinearisationError), and
+        estimateDrive() bounds the actual arguments from above. Measured against the
+        nonlinear ladder on sines from 55 Hz to 3 kHz, cutoffs from 100 Hz to 8 kHz and
+        K up to 3.9, the outputs then differ by at most 4.4e-4 of their peak.
+
+        The drive counts in units of 2 Vt, so the linear ladder only takes over below an
+        input of about half a millivolt, -64 dBFS at one volt full scale: the fades and
+        release tails, which it covers for 40% of a ten-second tail decaying from -12 dBFS.
+    */
+    static constexpr double maxDrive = 0.0547;
+    static_assert (maxDrive * maxDrive / 3.0 <= maxLinearisationError, "maxDrive keeps to maxLinearisationError");
+
+    /** Bounds the largest tanh argument LadderSolver would see in a block, from the
+        peak input, the peak output of the previous block and the peak ladder state.
+    */
+    static double estimateDrive (const LadderCoefficients& coefficients, double inputPeak,
+                                 double outputPeak, double statePeak) noexcept
+    {
+        return (inputPeak + outputPeak) * coefficients.inputScale
+                 + 2.0 * statePeak * coefficients.stageScale;
+    }
+
+    /** Runs one sample of every lane through the linearised ladder.
+
+        @param coefficients  circuit constants shared by all lanes
+        @param state         ladder state, advanced by one sample
+        @param vin           numLanes input samples, one per channel
+        @param vout          receives numLanes output samples
+    */
+    template <int stateStages>
+    static void processSample (const LadderCoefficients& coefficients, LadderState<numLanes, Type, stateStages>& state,
+                               const Type* vin, Type* vout) noexcept
+    {
+        static_assert (order <= stateStages, "the state holds fewer stages than the ladder");
+
+        using Vector = LadderVector<Type, numLanes>;
+
+        const Vector g0 ((Type) (coefficients.a * coefficients.inputScale));
+        const Vector g ((Type) (coefficients.a * coefficients.stageScale));
+        const Vector g4 ((Type) (coefficients.a * coefficients.lastStageScale));
+        const Vector outputGain ((Type) coefficients.outputGain);
+        const auto input = Vector::load (vin);
+
+        Vector d[order + 1], r[order], v[order], x[order + 1];
+
+        d[0] = g0;
+        d[order] = g4;
+
+        for (int i = 1; i < order; ++i)
+            d[i] = g;
+
+        LadderElimination<Vector, order> matrix;
+        matrix.factor (d, outputGain);
+
+        for (int i = 0; i < order; ++i)
+            r[i] = Vector::load (state.s[i]);
+
+        r[0] += g0 * input;
+
+        matrix.solve (r, v);
+
+        using Ladder = LadderSolver<Nonlinearities::ExactTanh, numLanes, Type, 0, order, response>;
+        Ladder::getOutput (coefficients, v, input).store (vout);
+
+        state.store (v);
+
+        // keeps an antialiased LadderSolver taking over from here on the right segment
+        Ladder::getArguments (coefficients, v, input, x);
+        state.template storeArguments<order> (x);
+    }
+};
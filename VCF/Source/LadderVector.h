@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    LadderVector.h
+
+    The SIMD register the ladder solver runs its lanes in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+#if defined (__AVX512F__)
+ #define VCF_LADDER_AVX512 1
+ #include <immintrin.h>
+#elif defined (__AVX__)
+ #define VCF_LADDER_AVX 1
+ #include <immintrin.h>
+#elif defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define VCF_LADDER_SSE2 1
+ #include <emmintrin.h>
+#elif defined (__ARM_NEON) && (defined (__aarch64__) || defined (_M_ARM64))
+ #define VCF_LADDER_NEON 1
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+/** Width of the widest SIMD register the build targets, in bytes. */
+#if VCF_LADDER_AVX512
+ static constexpr int ladderVectorBytes = 64;
+#elif VCF_LADDER_AVX
+ static constexpr int ladderVectorBytes = 32;
+#else
+ static constexpr int ladderVectorBytes = 16;
+#endif
+
+/** Number of channels a LadderSolver in the given precision runs side by side, one
+    register of them: two doubles or four floats for SSE2 and NEON, four doubles or
+    eight floats for AVX, and eight doubles or sixteen floats for AVX-512.
+*/
+template <typename Type>
+static constexpr int ladderLanesOf = ladderVectorBytes / (int) sizeof (Type);
+
+/** The most lanes a solver of any precision has, which is the float one. */
+static constexpr int ladderMaxLanes = ladderLanesOf<float>;
+
+//==============================================================================
+/**
+    The operations LadderVector needs, on numLanes values of Type.
+
+    This generic version holds the lanes in an array and loops over them, which
+    is what any lane count without a register of its own uses. A single lane is
+    a plain scalar, and the specialisations below map the lane count of
+    ladderLanesOf onto the intrinsics of the target, so a solver of that width
+    works on whole registers whether or not the compiler would have vectorised
+    the loops.
+
+    min() and max() return their second argument when either one is NaN, the
+    way the SSE instructions do, and allLessEqual() is false for a NaN lane.
+*/
+template <typename Type, int numLanes>
+struct LadderRegister
+{
+    struct Register { Type lane[numLanes]; };
+
+    static Register broadcast (Type value) noexcept     { Register r; for (int l = 0; l < numLanes; ++l) r.lane[l] = value; return r; }
+    static Register load (const Type* source) noexcept  { Register r; for (int l = 0; l < numLanes; ++l) r.lane[l] = source[l]; return r; }
+    static void store (Type* destination, Register a) noexcept { for (int l = 0; l < numLanes; ++l) destination[l] = a.lane[l]; }
+
+    static Register add (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] += b.lane[l]; return a; }
+    static Register sub (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] -= b.lane[l]; return a; }
+    static Register mul (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] *= b.lane[l]; return a; }
+    static Register div (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] /= b.lane[l]; return a; }
+    static Register min (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] = a.lane[l] < b.lane[l] ? a.lane[l] : b.lane[l]; return a; }
+    static Register max (Register a, Register b) noexcept { for (int l = 0; l < numLanes; ++l) a.lane[l] = a.lane[l] > b.lane[l] ? a.lane[l] : b.lane[l]; return a; }
+    static Register neg (Register a) noexcept             { for (int l = 0; l < numLanes; ++l) a.lane[l] = -a.lane[l]; return a; }
+    static Register abs (Register a) noexcept             { for (int l = 0; l < numLanes; ++l) a.lane[l] = std::abs (a.lane[l]); return a; }
+
+    static bool allLessEqual (Register a, Register b) noexcept
+    {
+        auto result = true;
+
+        for (int l = 0; l < numLanes; ++l)
+            result = result && a.lane[l] <= b.lane[l];
+
+        return result;
+    }
+};
+
+/** A single lane, held as a plain scalar. */
+template <typename Type>
+struct LadderRegister<Type, 1>
+{
+    using Register = Type;
+
+    static Register broadcast (Type value) noexcept           { return value; }
+    static Register load (const Type* source) noexcept        { return *source; }
+    static void store (Type* destination, Register a) noexcept { *destination = a; }
+
+    static Register add (Register a, Register b) noexcept { return a + b; }
+    static Register sub (Register a, Register b) noexcept { return a - b; }
+    static Register mul (Register a, Register b) noexcept { return a * b; }
+    static Register div (Register a, Register b) noexcept { return a / b; }
+    static Register min (Register a, Register b) noexcept { return a < b ? a : b; }
+    static Register max (Register a, Register b) noexcept { return a > b ? a : b; }
+    static Register neg (Register a) noexcept             { return -a; }
+    static Register abs (Register a) noexcept             { return std::abs (a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return a <= b; }
+};
+
+#if VCF_LADDER_AVX512
+template <>
+struct LadderRegister<double, 8>
+{
+    using Register = __m512d;
+
+    static Register broadcast (double value) noexcept           { return _mm512_set1_pd (value); }
+    static Register load (const double* source) noexcept        { return _mm512_loadu_pd (source); }
+    static void store (double* destination, Register a) noexcept { _mm512_storeu_pd (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm512_add_pd (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm512_sub_pd (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm512_mul_pd (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm512_div_pd (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm512_min_pd (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm512_max_pd (a, b); }
+    static Register neg (Register a) noexcept             { return _mm512_castsi512_pd (_mm512_xor_si512 (_mm512_castpd_si512 (a), _mm512_castpd_si512 (_mm512_set1_pd (-0.0)))); }
+    static Register abs (Register a) noexcept             { return _mm512_abs_pd (a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm512_cmp_pd_mask (a, b, _CMP_LE_OQ) == 0xff; }
+};
+
+template <>
+struct LadderRegister<float, 16>
+{
+    using Register = __m512;
+
+    static Register broadcast (float value) noexcept           { return _mm512_set1_ps (value); }
+    static Register load (const float* source) noexcept        { return _mm512_loadu_ps (source); }
+    static void store (float* destination, Register a) noexcept { _mm512_storeu_ps (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm512_add_ps (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm512_sub_ps (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm512_mul_ps (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm512_div_ps (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm512_min_ps (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm512_max_ps (a, b); }
+    static Register neg (Register a) noexcept             { return _mm512_castsi512_ps (_mm512_xor_si512 (_mm512_castps_si512 (a), _mm512_castps_si512 (_mm512_set1_ps (-0.0f)))); }
+    static Register abs (Register a) noexcept             { return _mm512_abs_ps (a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm512_cmp_ps_mask (a, b, _CMP_LE_OQ) == 0xffff; }
+};
+#elif VCF_LADDER_AVX
+template <>
+struct LadderRegister<double, 4>
+{
+    using Register = __m256d;
+
+    static Register broadcast (double value) noexcept           { return _mm256_set1_pd (value); }
+    static Register load (const double* source) noexcept        { return _mm256_loadu_pd (source); }
+    static void store (double* destination, Register a) noexcept { _mm256_storeu_pd (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm256_add_pd (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm256_sub_pd (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm256_mul_pd (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm256_div_pd (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm256_min_pd (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm256_max_pd (a, b); }
+    static Register neg (Register a) noexcept             { return _mm256_xor_pd (a, _mm256_set1_pd (-0.0)); }
+    static Register abs (Register a) noexcept             { return _mm256_andnot_pd (_mm256_set1_pd (-0.0), a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm256_movemask_pd (_mm256_cmp_pd (a, b, _CMP_LE_OQ)) == 0xf; }
+};
+
+template <>
+struct LadderRegister<float, 8>
+{
+    using Register = __m256;
+
+    static Register broadcast (float value) noexcept           { return _mm256_set1_ps (value); }
+    static Register load (const float* source) noexcept        { return _mm256_loadu_ps (source); }
+    static void store (float* destination, Register a) noexcept { _mm256_storeu_ps (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm256_add_ps (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm256_sub_ps (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm256_mul_ps (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm256_div_ps (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm256_min_ps (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm256_max_ps (a, b); }
+    static Register neg (Register a) noexcept             { return _mm256_xor_ps (a, _mm256_set1_ps (-0.0f)); }
+    static Register abs (Register a) noexcept             { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm256_movemask_ps (_mm256_cmp_ps (a, b, _CMP_LE_OQ)) == 0xff; }
+};
+#elif VCF_LADDER_SSE2
+template <>
+struct LadderRegister<double, 2>
+{
+    using Register = __m128d;
+
+    static Register broadcast (double value) noexcept           { return _mm_set1_pd (value); }
+    static Register load (const double* source) noexcept        { return _mm_loadu_pd (source); }
+    static void store (double* destination, Register a) noexcept { _mm_storeu_pd (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm_add_pd (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm_sub_pd (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm_mul_pd (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm_div_pd (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm_min_pd (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm_max_pd (a, b); }
+    static Register neg (Register a) noexcept             { return _mm_xor_pd (a, _mm_set1_pd (-0.0)); }
+    static Register abs (Register a) noexcept             { return _mm_andnot_pd (_mm_set1_pd (-0.0), a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm_movemask_pd (_mm_cmple_pd (a, b)) == 0x3; }
+};
+
+template <>
+struct LadderRegister<float, 4>
+{
+    using Register = __m128;
+
+    static Register broadcast (float value) noexcept           { return _mm_set1_ps (value); }
+    static Register load (const float* source) noexcept        { return _mm_loadu_ps (source); }
+    static void store (float* destination, Register a) noexcept { _mm_storeu_ps (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return _mm_add_ps (a, b); }
+    static Register sub (Register a, Register b) noexcept { return _mm_sub_ps (a, b); }
+    static Register mul (Register a, Register b) noexcept { return _mm_mul_ps (a, b); }
+    static Register div (Register a, Register b) noexcept { return _mm_div_ps (a, b); }
+    static Register min (Register a, Register b) noexcept { return _mm_min_ps (a, b); }
+    static Register max (Register a, Register b) noexcept { return _mm_max_ps (a, b); }
+    static Register neg (Register a) noexcept             { return _mm_xor_ps (a, _mm_set1_ps (-0.0f)); }
+    static Register abs (Register a) noexcept             { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return _mm_movemask_ps (_mm_cmple_ps (a, b)) == 0xf; }
+};
+#elif VCF_LADDER_NEON
+template <>
+struct LadderRegister<double, 2>
+{
+    using Register = float64x2_t;
+
+    static Register broadcast (double value) noexcept           { return vdupq_n_f64 (value); }
+    static Register load (const double* source) noexcept        { return vld1q_f64 (source); }
+    static void store (double* destination, Register a) noexcept { vst1q_f64 (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return vaddq_f64 (a, b); }
+    static Register sub (Register a, Register b) noexcept { return vsubq_f64 (a, b); }
+    static Register mul (Register a, Register b) noexcept { return vmulq_f64 (a, b); }
+    static Register div (Register a, Register b) noexcept { return vdivq_f64 (a, b); }
+    static Register min (Register a, Register b) noexcept { return vbslq_f64 (vcltq_f64 (a, b), a, b); }
+    static Register max (Register a, Register b) noexcept { return vbslq_f64 (vcgtq_f64 (a, b), a, b); }
+    static Register neg (Register a) noexcept             { return vnegq_f64 (a); }
+    static Register abs (Register a) noexcept             { return vabsq_f64 (a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return vminvq_u32 (vreinterpretq_u32_u64 (vcleq_f64 (a, b))) != 0; }
+};
+
+template <>
+struct LadderRegister<float, 4>
+{
+    using Register = float32x4_t;
+
+    static Register broadcast (float value) noexcept           { return vdupq_n_f32 (value); }
+    static Register load (const float* source) noexcept        { return vld1q_f32 (source); }
+    static void store (float* destination, Register a) noexcept { vst1q_f32 (destination, a); }
+
+    static Register add (Register a, Register b) noexcept { return vaddq_f32 (a, b); }
+    static Register sub (Register a, Register b) noexcept { return vsubq_f32 (a, b); }
+    static Register mul (Register a, Register b) noexcept { return vmulq_f32 (a, b); }
+    static Register div (Register a, Register b) noexcept { return vdivq_f32 (a, b); }
+    static Register min (Register a, Register b) noexcept { return vbslq_f32 (vcltq_f32 (a, b), a, b); }
+    static Register max (Register a, Register b) noexcept { return vbslq_f32 (vcgtq_f32 (a, b), a, b); }
+    static Register neg (Register a) noexcept             { return vnegq_f32 (a); }
+    static Register abs (Register a) noexcept             { return vabsq_f32 (a); }
+
+    static bool allLessEqual (Register a, Register b) noexcept { return vminvq_u32 (vcleq_f32 (a, b)) != 0; }
+};
+#endif
+
+//==============================================================================
+/**
+    numLanes values of Type in one register, with the arithmetic of a scalar.
+
+    LadderSolver writes each step of its iteration once, in these, and gets
+    one instruction per operation for all of its lanes. There is no implicit
+    conversion from Type: a constant is broadcast explicitly, so a scalar never
+    slips into a lane expression unnoticed.
+*/
+template <typename Type, int numLanes>
+struct LadderVector
+{
+    using Ops = LadderRegister<Type, numLanes>;
+    using ValueType = Type;
+
+    LadderVector() noexcept = default;
+    explicit LadderVector (Type value) noexcept : value (Ops::broadcast (value)) {}
+
+    static LadderVector load (const Type* source) noexcept  { return wrap (Ops::load (source)); }
+    void store (Type* destination) const noexcept           { Ops::store (destination, value); }
+
+    friend LadderVector operator+ (LadderVector a, LadderVector b) noexcept { return wrap (Ops::add (a.value, b.value)); }
+    friend LadderVector operator- (LadderVector a, LadderVector b) noexcept { return wrap (Ops::sub (a.value, b.value)); }
+    friend LadderVector operator* (LadderVector a, LadderVector b) noexcept { return wrap (Ops::mul (a.value, b.value)); }
+    friend LadderVector operator/ (LadderVector a, LadderVector b) noexcept { return wrap (Ops::div (a.value, b.value)); }
+    friend LadderVector operator- (LadderVector a) noexcept                 { return wrap (Ops::neg (a.value)); }
+
+    LadderVector& operator+= (LadderVector other) noexcept { value = Ops::add (value, other.value); return *this; }
+    LadderVector& operator-= (LadderVector other) noexcept { value = Ops::sub (value, other.value); return *this; }
+    LadderVector& operator*= (LadderVector other) noexcept { value = Ops::mul (value, other.value); return *this; }
+
+    friend LadderVector min (LadderVector a, LadderVector b) noexcept { return wrap (Ops::min (a.value, b.value)); }
+    friend LadderVector max (LadderVector a, LadderVector b) noexcept { return wrap (Ops::max (a.value, b.value)); }
+    friend LadderVector abs (LadderVector a) noexcept                 { return wrap (Ops::abs (a.value)); }
+
+    /** True if every lane of a is at most the same lane of b, and neither is NaN. */
+    friend bool allLessEqual (LadderVector a, LadderVector b) noexcept { return Ops::allLessEqual (a.value, b.value); }
+
+    typename Ops::Register value;
+
+private:
+    static LadderVector wrap (typename Ops::Register v) noexcept { LadderVector result; result.value = v; return result; }
+};
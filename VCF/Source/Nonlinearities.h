@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    Nonlinearities.h
+
+    tanh kernels the ladder solver can be instantiated with.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+/**
+    Each policy provides a static process() that the solver calls for all
+    tanh evaluations of a Newton iteration. A policy with vectorised set takes
+    a whole LadderVector of arguments in the same call, so the tanh of every
+    lane runs in the registers the rest of the step does; the solver runs the
+    others one lane at a time.
+
+    The solver takes the derivative as 1 - y^2 from the returned value, which
+    for the approximations is only close to their true slope; Newton then
+    converges to the same fixed point, just not strictly quadratically.
+
+    A policy with antialiased set also depends on the argument the same tanh
+    had on the previous sample, and returns its own slope (see AntialiasedTanh).
+*/
+namespace Nonlinearities
+{
+    /** The quality settings, in the order the quality parameter lists them. */
+    enum class Quality
+    {
+        exact = 0,
+        pade,
+        table,
+        antialiased
+    };
+
+    //==============================================================================
+    /** std::tanh. Reference accuracy, but a libm call with no vector form, so it
+        is scalar only: the solver evaluates it one lane at a time.
+    */
+    struct ExactTanh
+    {
+        static constexpr double maxError = 0.0;
+        static constexpr bool antialiased = false;
+        static constexpr bool vectorised = false;
+
+        template <typename Type>
+        static Type process (Type x) noexcept           { return std::tanh (x); }
+    };
+
+    //==============================================================================
+    /** [7/6] Pade approximant of tanh (the Lambert continued fraction cut after
+        seven terms), with the input clamped where the rational function reaches
+        one so that it saturates continuously.
+
+        Max absolute error: 9.7e-5, just below the clamp at |x| = 4.97.
+
+        Written for a scalar and a LadderVector alike, with the clamp as a
+        min and a max, so a solver of n lanes runs it as packed instructions:
+        seven multiplies, six adds and one divide for all the lanes.
+    */
+    struct PadeTanh
+    {
+        static constexpr double maxError = 9.7e-5;
+        static constexpr bool antialiased = false;
+        static constexpr bool vectorised = true;
+        static constexpr double clampLevel = 4.971787;
+
+        template <typename Type>
+        static Type process (Type x) noexcept
+        {
+            using std::min, std::max;
+            x = max (min (x, (Type) clampLevel), (Type) -clampLevel);
+
+            const auto x2 = x * x;
+            const auto numerator   = x * ((Type) 135135 + x2 * ((Type) 17325 + x2 * ((Type) 378 + x2)));
+            const auto denominator = (Type) 135135 + x2 * ((Type) 62370 + x2 * ((Type) 3150 + x2 * (Type) 28));
+
+            return numerator / denominator;
+        }
+    };
+
+    //==============================================================================
+    /** tanh sampled at 1024 points over [-8, 8] and linearly interpolated, held
+        at the end points outside that range.
+
+        Max absolute error: 2.4e-5, around |x| = 0.66 where tanh bends hardest.
+
+        The table is filled during static initialisation, so the audio thread
+        never pays for building it or for a first-use guard. The step to the
+        next point has an array of its own, so an interpolation reads both
+        numbers at the same index, the layout a gather would need.
+
+        The lookup is a gather, which SSE2 and NEON have no instruction for,
+        so TableTanh stays scalar: the solver evaluates it one lane at a time.
+    */
+    struct TableTanh
+    {
+        static constexpr double maxError = 2.4e-5;
+        static constexpr bool antialiased = false;
+        static constexpr bool vectorised = false;
+        static constexpr int tableSize = 1024;
+        static constexpr double range = 8.0;
+
+        template <typename Type>
+        static Type process (Type x) noexcept
+        {
+            constexpr auto scale = (Type) ((tableSize - 1) / (2.0 * range));
+
+            x = x < (Type) -range ? (Type) -range : (x > (Type) range ? (Type) range : x);
+
+            const auto position = (x + (Type) range) * scale;
+            auto index = (int) position;
+            index = index > tableSize - 2 ? tableSize - 2 : index;
+            const auto fraction = position - (Type) index;
+
+            return (Type) table.values[index] + fraction * (Type) table.steps[index];
+        }
+
+    private:
+        struct Table
+        {
+            Table()
+            {
+                for (int i = 0; i < tableSize; ++i)
+                    values[i] = std::tanh (-range + 2.0 * range * i / (tableSize - 1));
+
+                for (int i = 0; i < tableSize; ++i)
+                    steps[i] = i < tableSize - 1 ? values[i + 1] - values[i] : 0.0;
+            }
+
+            double values[tableSize];
+            double steps[tableSize]; // values[i + 1] - values[i]
+        };
+
+        static const Table table;
+    };
+
+    inline const TableTanh::Table TableTanh::table;
+
+    //==============================================================================
+    /** First-order antiderivative antialiasing of std::tanh.
+
+        Rather than tanh at the current argument x, returns its mean over the
+        segment from the previous sample's argument x1,
+
+            (F (x) - F (x1)) / (x - x1)   with   F (x) = log cosh (x),
+
+        which is tanh seen through a one-sample box filter before it is sampled,
+        so the harmonics that would fold back are attenuated by that filter's
+        sinc response. The solver passes F (x1) in, since it is fixed for the
+        whole sample, and takes the slope with respect to x from here. On a
+        segment too short for the division to stay accurate, the mean falls
+        back to tanh at its midpoint.
+
+        Costs a log1p, an exp and a tanh per evaluation, so it pays off by
+        letting the oversampling factor drop, not per call. Those are libm
+        calls like ExactTanh's, so it is scalar only too.
+    */
+    struct AntialiasedTanh
+    {
+        static constexpr double maxError = 0.0;
+        static constexpr bool antialiased = true;
+        static constexpr bool vectorised = false;
+
+        /** log cosh (x), written as |x| + log (1 + e^-2|x|) - log 2 so it cannot overflow. */
+        template <typename Type>
+        static Type antiderivative (Type x) noexcept
+        {
+            const auto magnitude = std::abs (x);
+            return magnitude + std::log1p (std::exp ((Type) -2 * magnitude)) - (Type) 0.69314718055994531;
+        }
+
+        template <typename Type>
+        static Type process (Type x, Type previous, Type previousAntiderivative, Type& slope) noexcept
+        {
+            constexpr auto minSegment = (Type) (sizeof (Type) < sizeof (double) ? 1.0e-2 : 1.0e-6);
+            const auto segment = x - previous;
+
+            if (std::abs (segment) < minSegment)
+            {
+                const auto y = std::tanh ((Type) 0.5 * (x + previous));
+                slope = (Type) 0.5 * ((Type) 1 - y * y);
+                return y;
+            }
+
+            const auto y = (antiderivative (x) - previousAntiderivative) / segment;
+            slope = (std::tanh (x) - y) / segment;
+            return y;
+        }
+    };
+}
@@ -15,7 +15,7 @@ VCFAudioProcessorEditor::VCFAudioProcessorEditor (VCFAudioProcessor& p, juce::Au
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (300, 250);
+    setSize (300, 385);
     
 
     controlK.setColour(0x1001400, juce::Colour::fromRGBA(0x80, 0x80, 0x80, 0x80));
@@ -59,13 +59,40 @@ VCFAudioProcessorEditor::VCFAudioProcessorEditor (VCFAudioProcessor& p, juce::Au
     labelVt.setColour(juce::Label::textColourId, juce::Colour(3, 3, 3));
     addAndMakeVisible(labelVt);
 
+    addChoiceBox(qualityBox, "quality_ID", comboAttachQuality);
+    addChoiceBox(oversamplingBox, "oversampling_ID", comboAttachOversampling);
+    addChoiceBox(oversamplingFilterBox, "oversamplingFilter_ID", comboAttachOversamplingFilter);
+    addChoiceBox(ecoBox, "eco_ID", comboAttachEco);
+    addChoiceBox(solverBox, "solver_ID", comboAttachSolver);
+    addChoiceBox(orderBox, "order_ID", comboAttachOrder);
+    addChoiceBox(polyBox, "poly_ID", comboAttachPoly);
+    addChoiceBox(governorBox, "governor_ID", comboAttachGovernor);
+    addChoiceBox(linkBox, "link_ID", comboAttachLink);
+
+    telemetryLabel.setFont(juce::Font(11.0f));
+    telemetryLabel.setJustificationType(juce::Justification::topLeft);
+    telemetryLabel.setColour(juce::Label::textColourId, juce::Colour(3, 3, 3));
+    addAndMakeVisible(telemetryLabel);
+
+    lastTelemetry = audioProcessor.getTelemetry();
+    startTimerHz(4);
 }
 
 VCFAudioProcessorEditor::~VCFAudioProcessorEditor()
 {
+    stopTimer();
     sliderAttachK.reset();
     sliderAttachF0.reset();
     sliderAttachVt.reset();
+    comboAttachQuality.reset();
+    comboAttachOversampling.reset();
+    comboAttachOversamplingFilter.reset();
+    comboAttachEco.reset();
+    comboAttachSolver.reset();
+    comboAttachOrder.reset();
+    comboAttachPoly.reset();
+    comboAttachGovernor.reset();
+    comboAttachLink.reset();
 }
 
 //==============================================================================
@@ -97,7 +124,72 @@ void VCFAudioProcessorEditor::resized()
     labelF0.setBounds(0, getHeight() - 20, fPos, 20);
     labelVt.setBounds((getWidth() - 70 - 40 / 2), getHeight() - labelHeight - 20, 70, labelHeight);
 
+    // choice boxes stack down the middle column, between the two vertical sliders
+    int boxX = 40 + sliderWidth + 20, boxWidth = getWidth() - 2 * boxX, boxHeight = 20;
+    qualityBox.setBounds(boxX, 10, boxWidth, boxHeight);
+    oversamplingBox.setBounds(boxX, 10 + boxHeight + 5, boxWidth, boxHeight);
+    oversamplingFilterBox.setBounds(boxX, 10 + 2 * (boxHeight + 5), boxWidth, boxHeight);
+    ecoBox.setBounds(boxX, 10 + 3 * (boxHeight + 5), boxWidth, boxHeight);
+    solverBox.setBounds(boxX, 10 + 4 * (boxHeight + 5), boxWidth, boxHeight);
+    orderBox.setBounds(boxX, 10 + 5 * (boxHeight + 5), boxWidth, boxHeight);
+    polyBox.setBounds(boxX, 10 + 6 * (boxHeight + 5), boxWidth, boxHeight);
+    governorBox.setBounds(boxX, 10 + 7 * (boxHeight + 5), boxWidth, boxHeight);
+    linkBox.setBounds(boxX, 10 + 8 * (boxHeight + 5), boxWidth, boxHeight);
+    telemetryLabel.setBounds(boxX, 10 + 9 * (boxHeight + 5), boxWidth, 105);
+
 }
 void VCFAudioProcessorEditor::sliderValueChanged (juce::Slider* slider)
 {
-}
\ No newline at end of file
+}
+void VCFAudioProcessorEditor::timerCallback()
+{
+    // rates over the last timer interval, from the snapshot the audio thread publishes
+    auto current = audioProcessor.getTelemetry();
+
+    if (current.blocks < lastTelemetry.blocks)
+        lastTelemetry = {};
+
+    if (current.blocks == lastTelemetry.blocks)
+        return;
+
+    auto samples = (double) juce::jmax((juce::uint64) 1, current.samples - lastTelemetry.samples);
+    auto deadline = current.deadlineSeconds - lastTelemetry.deadlineSeconds;
+    auto load = deadline > 0.0 ? (current.busySeconds - lastTelemetry.busySeconds) / deadline : 0.0;
+    auto tanhRate = deadline > 0.0 ? (double) (current.tanhCalls - lastTelemetry.tanhCalls) / deadline : 0.0;
+
+    // the share of samples per iteration count, leaving out the counts no sample took
+    juce::String histogram("iters");
+
+    for (int i = 0; i <= ladderMaxIterations; ++i)
+    {
+        auto share = (double) (current.iterationHistogram[i] - lastTelemetry.iterationHistogram[i]) / samples;
+
+        if (share >= 0.005)
+            histogram << " " << i << ":" << juce::String(100.0 * share, 0) << "%";
+    }
+
+    telemetryLabel.setText("iter/sample " + juce::String((double) (current.iterations - lastTelemetry.iterations) / samples, 2)
+                           + "  max " + juce::String(VCFAudioProcessor::SolverStats::getMaxIterations(lastTelemetry, current))
+                           + "\n" + histogram
+                           + "\ntanh/s " + (tanhRate >= 1.0e6 ? juce::String(tanhRate * 1.0e-6, 1) + "M" : juce::String(tanhRate * 1.0e-3, 0) + "k")
+                           + "\nnot converged " + juce::String(current.nonConverged - lastTelemetry.nonConverged)
+                           + "  linear " + juce::String(100.0 * (double) (current.linearSamples - lastTelemetry.linearSamples) / samples, 0) + "%"
+                           + "\nload " + juce::String(100.0 * load, 1) + "%  peak " + juce::String(100.0 * current.maxLoad, 1) + "%"
+                           + "\noverruns " + juce::String(current.overruns) + "  voices " + juce::String(current.voices)
+                           + "\ngovernor level " + juce::String(current.governorLevel)
+                           + "  linked " + juce::String(100.0 * (double) (current.linkedSamples - lastTelemetry.linkedSamples) / samples, 0) + "%",
+                           juce::dontSendNotification);
+
+    lastTelemetry = current;
+}
+void VCFAudioProcessorEditor::addChoiceBox(juce::ComboBox& box, const juce::String& parameterID,
+                                           std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment)
+{
+    // the items have to be there before the attachment sets the current one
+    if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(audioTree.getParameter(parameterID)))
+        box.addItemList(choice->choices, 1);
+
+    box.setTooltip(audioTree.getParameter(parameterID)->getName(32));
+    addAndMakeVisible(box);
+    attachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(audioTree, parameterID, box));
+}
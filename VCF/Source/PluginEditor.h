@@ -15,7 +15,8 @@
 /**
 */
 class VCFAudioProcessorEditor  : public juce::AudioProcessorEditor,
-                                       private juce::Slider::Listener 
+                                       private juce::Slider::Listener,
+                                       private juce::Timer
 {
 public:
     VCFAudioProcessorEditor (VCFAudioProcessor&, juce::AudioProcessorValueTreeState&);
@@ -23,8 +24,11 @@ public:
 
     //==============================================================================
     void sliderValueChanged(juce::Slider* slider) override;
+    void timerCallback() override;
     void paint (juce::Graphics&) override;
     void resized() override;
+    void addChoiceBox(juce::ComboBox& box, const juce::String& parameterID,
+                      std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment);
 
 private:
     VCFAudioProcessor& audioProcessor;
@@ -38,10 +42,30 @@ private:
     juce::Label labelK;
     juce::Label labelF0;
     juce::Label labelVt;
+    juce::ComboBox qualityBox;
+    juce::ComboBox oversamplingBox;
+    juce::ComboBox oversamplingFilterBox;
+    juce::ComboBox ecoBox;
+    juce::ComboBox solverBox;
+    juce::ComboBox orderBox;
+    juce::ComboBox polyBox;
+    juce::ComboBox governorBox;
+    juce::ComboBox linkBox;
+    juce::Label telemetryLabel;
+    VCFAudioProcessor::SolverStats lastTelemetry;
 
     std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> sliderAttachK;
     std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> sliderAttachF0;
     std::unique_ptr <juce::AudioProcessorValueTreeState::SliderAttachment> sliderAttachVt;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachQuality;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachOversampling;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachOversamplingFilter;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachEco;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachSolver;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachOrder;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachPoly;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachGovernor;
+    std::unique_ptr <juce::AudioProcessorValueTreeState::ComboBoxAttachment> comboAttachLink;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VCFAudioProcessorEditor)
 };
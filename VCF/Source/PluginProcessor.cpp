@@ -7,7 +7,10 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+#include "TelemetryLog.h"
+#if ! VCF_HEADLESS
+ #include "PluginEditor.h"
+#endif
 
 
 //==============================================================================
@@ -17,6 +20,7 @@ VCFAudioProcessor::VCFAudioProcessor()
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
         .withInput("Input", juce::AudioChannelSet::stereo(), true)
+        .withInput("Sidechain", juce::AudioChannelSet::mono(), false) // cutoff CV, and feedback CV when stereo
 #endif
         .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
@@ -24,25 +28,54 @@ VCFAudioProcessor::VCFAudioProcessor()
     audioTree(*this, nullptr, juce::Identifier("PARAMETERS"),
         { std::make_unique<juce::AudioParameterFloat>("controlK_ID","ControlK",juce::NormalisableRange<float>(0.0, 4.0, 0.001),0.5),
           std::make_unique<juce::AudioParameterFloat>("controlF0_ID","ControlF0",juce::NormalisableRange<float>(50.0, 3000.0, 1.0),1000.0),
-          std::make_unique<juce::AudioParameterFloat>("controlVt_ID","ControlVt",juce::NormalisableRange<float>(0.0, 0.05, 0.00001),0.026)
-        }),
-    lowPassFilter(juce::dsp::IIR::Coefficients< float >::makeLowPass((48000.0 * 4.0), 20000.0))
+          std::make_unique<juce::AudioParameterFloat>("controlVt_ID","ControlVt",juce::NormalisableRange<float>(0.0, 0.05, 0.00001),0.026),
+          std::make_unique<juce::AudioParameterChoice>("quality_ID","Quality",juce::StringArray{ "Exact", "Pade", "Table", "ADAA" },VCF_DEFAULT_TANH_QUALITY),
+          std::make_unique<juce::AudioParameterChoice>("oversampling_ID","Oversampling",juce::StringArray{ "1x", "2x", "4x", "8x", "16x" },VCF_DEFAULT_OVERSAMPLING),
+          std::make_unique<juce::AudioParameterChoice>("oversamplingFilter_ID","Oversampling Filter",juce::StringArray{ "IIR", "Linear Phase FIR" },0),
+          std::make_unique<juce::AudioParameterFloat>("cvCutoffDepth_ID","CV Cutoff Depth",juce::NormalisableRange<float>(-8.0, 8.0, 0.01),2.0),
+          std::make_unique<juce::AudioParameterFloat>("cvFeedbackDepth_ID","CV Feedback Depth",juce::NormalisableRange<float>(-4.0, 4.0, 0.001),0.0),
+          std::make_unique<juce::AudioParameterChoice>("eco_ID","Eco",juce::StringArray{ "Eco Off", "Eco On" },0),
+          std::make_unique<juce::AudioParameterChoice>("solver_ID","Solver",juce::StringArray{ "Converge", "Fixed Cost" },0),
+          std::make_unique<juce::AudioParameterChoice>("order_ID","Order",juce::StringArray{ "2 Pole", "4 Pole", "6 Pole", "8 Pole" },1),
+          std::make_unique<juce::AudioParameterChoice>("poly_ID","Polyphony",juce::StringArray{ "Poly Off", "Poly On" },0),
+          std::make_unique<juce::AudioParameterChoice>("governor_ID","Governor",juce::StringArray{ "Governor Off", "Governor On" },1),
+          std::make_unique<juce::AudioParameterChoice>("link_ID","Stereo Link",juce::StringArray{ "Link Off", "Link Auto" },1)
+        })
 #endif
 {
-    oversampling.reset(new juce::dsp::Oversampling<float>(2, 2, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, false));
     audioTree.addParameterListener("controlK_ID", this);
     audioTree.addParameterListener("controlF0_ID", this);
     audioTree.addParameterListener("controlVt_ID", this);
+    audioTree.addParameterListener("quality_ID", this);
+    audioTree.addParameterListener("oversampling_ID", this);
+    audioTree.addParameterListener("oversamplingFilter_ID", this);
+    audioTree.addParameterListener("cvCutoffDepth_ID", this);
+    audioTree.addParameterListener("cvFeedbackDepth_ID", this);
+    audioTree.addParameterListener("eco_ID", this);
+    audioTree.addParameterListener("solver_ID", this);
+    audioTree.addParameterListener("order_ID", this);
+    audioTree.addParameterListener("poly_ID", this);
+    audioTree.addParameterListener("governor_ID", this);
+    audioTree.addParameterListener("link_ID", this);
+
+   #if ! VCF_HEADLESS
+    // Lets a plugin session be logged without touching the UI. The headless tools leave it
+    // to their own options, since VCFBatch runs a processor per thread and they would all
+    // append to the same file.
+    auto logPath = juce::SystemStats::getEnvironmentVariable("VCF_TELEMETRY_LOG", {});
+
+    if (juce::File::isAbsolutePath(logPath))
+        startTelemetryLog(juce::File(logPath));
+   #endif
 
-    controlledK = 0.5;
-    controlledF0 = 1000.0;
-    controlledVt = 0.026;
+    tailSeconds = computeTailSeconds(controlledK.load(), controlledF0.load(), controlledVt.load(), ladderOrder.load());
 
 }
 
 VCFAudioProcessor::~VCFAudioProcessor()
 {
-    oversampling.reset();
+    cancelPendingUpdate();
+    stopTelemetryLog();
 }
 
 //==============================================================================
@@ -53,7 +86,11 @@ const juce::String VCFAudioProcessor::getName() const
 
 bool VCFAudioProcessor::acceptsMidi() const
 {
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
     return false;
+   #endif
 }
 
 bool VCFAudioProcessor::producesMidi() const
@@ -68,7 +105,7 @@ bool VCFAudioProcessor::isMidiEffect() const
 
 double VCFAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailSeconds.load();
 }
 
 int VCFAudioProcessor::getNumPrograms()
@@ -101,40 +138,155 @@ void VCFAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
     
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    oversampling->reset();
-    oversampling->initProcessing(static_cast<size_t> (samplesPerBlock));
+    hostFs = sampleRate;
+
+    // nothing is sized for the host's blocks, which are processed in sub-blocks of subBlockSamples
+    juce::ignoreUnused(samplesPerBlock);
+
+    // the voice layout depends on the channel count and the lanes of the precision, and the engine sizes its voice states after it
+    auto numLanes = isUsingDoublePrecision() ? Engine<double>::numLanes : Engine<float>::numLanes;
+    voices.prepare(getTotalNumOutputChannels(), numLanes);
+    activePolyphonic = polyphonic.load();
+
+    // every session starts at full quality, and unbypassed until the host says otherwise
+    governor.reset();
+    bypassMix.reset(sampleRate, bypassFadeSeconds);
+    bypassMix.setCurrentAndTargetValue(0.0);
+    activeQuality = quality.load();
 
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate * 4;
-    spec.maximumBlockSize = samplesPerBlock * 3;
-    spec.numChannels = getTotalNumOutputChannels();
+    // the host picks the precision before preparing, so only that engine needs its buffers
+    int factor;
+
+    if (isUsingDoublePrecision())
+    {
+        floatEngine = {};
+        prepareEngine(doubleEngine);
+        factor = (int) doubleEngine.activeResampler->oversampling->getOversamplingFactor();
+        setLatencySamples(juce::roundToInt(doubleEngine.activeResampler->oversampling->getLatencyInSamples()));
+    }
+    else
+    {
+        doubleEngine = {};
+        prepareEngine(floatEngine);
+        factor = (int) floatEngine.activeResampler->oversampling->getOversamplingFactor();
+        setLatencySamples(juce::roundToInt(floatEngine.activeResampler->oversampling->getLatencyInSamples()));
+    }
 
-    lowPassFilter.prepare(spec);
-    lowPassFilter.reset();
     // Set the constants
-    Fs = sampleRate;
+    Fs = sampleRate * (double) factor;
     T = 1 / Fs;
-    C = 0.01e-6;
-    f0 = 500.0;
-    Vt = 0.026;
-    I0 = 2.0 * Fs * std::tan(2.0 * 3.14 * f0 / Fs / 2.0) * 8.0 * C * Vt;
-    eta = 1.836;
-    gamma = eta * Vt;
-    err = 10e-4;
-    K = 0.5; // gfbbk in MALTLAB
+    C = LadderCircuit::capacitance;
+    Vt = LadderCircuit::thermalVoltage;
+    eta = LadderCircuit::eta;
+    err = LadderCircuit::tolerance;
+
+    // start from the current parameter values, without ramping in from the previous session
+    parameterRampSamples = (int) (parameterRampSeconds * sampleRate);
+    smoothedK.reset(controlledK.load());
+    smoothedOctave.reset(std::log2(controlledF0.load()));
+    smoothedVt.reset(controlledVt.load());
+
+    K = smoothedK.current; // gfbbk in MALTLAB
+    f0 = controlledF0.load();
+    I0 = LadderCircuit::getBiasCurrent(f0, smoothedVt.current, Fs);
+    gamma = eta * smoothedVt.current;
+    LadderCircuit::setCoefficients(ladderCoefficients, f0, K, smoothedVt.current, Fs, err);
+
+    // CV modulation, upsampled to the solver rate one sub-block at a time
+    modulatedA.resize((size_t) subBlockSamples);
+    modulatedGain.resize((size_t) subBlockSamples);
+    lastCv[0] = lastCv[1] = 0.0;
+
+    silentSamples.assign((size_t) getTotalNumOutputChannels(), 0);
+    idleGroups.assign((size_t) ((getTotalNumOutputChannels() + numLanes - 1) / numLanes), 0);
+    idle = false;
+    linearGroups.assign(idleGroups.size(), 0);
+    outputPeaks.assign(idleGroups.size(), 0.0);
+    outgoingLinearGroups.assign(idleGroups.size(), 0);
+    outgoingOutputPeaks.assign(idleGroups.size(), 0.0);
+    groupStats.assign(idleGroups.size(), {});
+
+    // the async update may not have run yet, e.g. offline with parameters set just before
+    tailSeconds = computeTailSeconds(controlledK.load(), controlledF0.load(), controlledVt.load(), ladderOrder.load());
+
+    // one worker per group beyond the one the audio thread takes itself, spawned here rather than on the audio thread
+    auto numWorkers = juce::jmin((int) idleGroups.size(), juce::SystemStats::getNumCpus()) - 1;
+
+    if (maxWorkers >= 0)
+        numWorkers = juce::jmin(numWorkers, maxWorkers);
+
+    if (numWorkers <= 0)
+        workerPool.reset();
+    else if (workerPool == nullptr || workerPool->getNumWorkers() != numWorkers)
+        workerPool.reset(new WorkerPool(numWorkers));
+}
+
+template <typename SampleType>
+void VCFAudioProcessor::prepareEngine(Engine<SampleType>& engine)
+{
+    using Oversampling = juce::dsp::Oversampling<SampleType>;
+
+    auto numChannels = juce::jmax(1, getTotalNumOutputChannels());
+
+    for (int index = 0; index < (int) engine.resamplers.size(); ++index)
+    {
+        auto& resampler = engine.resamplers[(size_t) index];
+        auto isLinearPhase = index > maxOversamplingStages;
+
+        resampler.reset(new Resampler<SampleType>());
+        resampler->numStages = index % (maxOversamplingStages + 1);
+        resampler->oversampling.reset(new Oversampling((size_t) numChannels, (size_t) resampler->numStages,
+                                                       isLinearPhase ? Oversampling::filterHalfBandFIREquiripple
+                                                                     : Oversampling::filterHalfBandPolyphaseIIR,
+                                                       false));
+
+        // only ever sees one sub-block at a time, however long the host's blocks are
+        resampler->oversampling->initProcessing(static_cast<size_t> (subBlockSamples));
+    }
+
+    // room for the largest latency the governor's delay could have to make up, while the line is being written
+    auto maxLatency = 0;
+
+    for (auto& resampler : engine.resamplers)
+        maxLatency = juce::jmax(maxLatency, (int) std::ceil(resampler->oversampling->getLatencyInSamples()));
+
+    engine.latencyDelay.setSize(numChannels, maxLatency + 1);
+    engine.latencyDelay.clear();
+    engine.delaySamples = engine.delayPosition = 0;
+    engine.outgoingBlock.setSize(numChannels, subBlockSamples);
+
+    // the bypass reads its delay line at any latency up to that, while it is being written
+    engine.dryDelay.setSize(numChannels, maxLatency + 1);
+    engine.dryDelay.clear();
+    engine.dryBlock.setSize(numChannels, subBlockSamples);
+    engine.dryPosition = 0;
+
+    engine.activeResampler = engine.resamplers[(size_t) getResamplerIndex(oversamplingStages.load(), linearPhase.load())].get();
+
     // Set the initial values to zero
-    voutTemp = 0.0;
-    vc2Temp = vc3Temp = vc4Temp = 0.0;
-    vc11Temp = vc21Temp = vc31Temp = vc41Temp = 0.0;
-    vc1 = vc2 = vc3 = vc4 = 0.0;
-    vc11 = vc21 = vc31 = vc41 = 0.0;
-    vin1 = 0.0;
-    vout = 0.0;
-    s1 = s2 = s3 = s4 = 0.0;
-    xc1 = xc2 = xc3 = xc4 = 0.0;
-    // set controlled values to starting values (redundant maybe delit later)
-    controlledK = 0.5;
-    controlledF0 = 1000.0;
+    engine.ladderStates.resize((size_t) ((getTotalNumOutputChannels() + engine.numLanes - 1) / engine.numLanes));
+
+    for (auto& state : engine.ladderStates)
+        state.reset();
+
+    engine.voiceStates.resize((size_t) voices.getNumGroups());
+
+    for (auto& state : engine.voiceStates)
+        state.reset();
+
+    engine.outgoingLadderStates.resize(engine.ladderStates.size());
+    engine.outgoingVoiceStates.resize(engine.voiceStates.size());
+
+    activeOrder = ladderOrder.load();
+}
+
+template <typename SampleType>
+VCFAudioProcessor::Engine<SampleType>& VCFAudioProcessor::getEngine() noexcept
+{
+    if constexpr (std::is_same<SampleType, double>::value)
+        return doubleEngine;
+    else
+        return floatEngine;
 }
 
 void VCFAudioProcessor::releaseResources()
@@ -149,145 +301,1107 @@ bool VCFAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) cons
      || layouts.getMainOutputChannelSet() == juce::AudioChannelSet::disabled())
         return false;
         
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // anything from mono up to 7.1.4 or third-order ambisonics, each channel filtered on its own
+    if (layouts.getMainOutputChannelSet().size() > maxChannels)
         return false;
     
+    if (layouts.inputBuses.size() > 1
+     && layouts.inputBuses[1] != juce::AudioChannelSet::disabled()
+     && layouts.inputBuses[1] != juce::AudioChannelSet::mono()
+     && layouts.inputBuses[1] != juce::AudioChannelSet::stereo())
+        return false;
+
     return layouts.getMainInputChannelSet() == layouts.getMainOutputChannelSet();
 }
 
 void VCFAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    process(buffer, midiMessages, false);
+}
+
+void VCFAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages, false);
+}
+
+void VCFAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages, true);
+}
+
+void VCFAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, midiMessages, true);
+}
+
+bool VCFAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    // the oversampling, the filters and the solver all run natively in the host's precision
+    return true;
+}
+
+template <typename SampleType>
+void VCFAudioProcessor::process (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midi, bool bypass)
+{
+    RealtimeCheck::ScopedAudioCallback realtimeCheck;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
     auto mainInputOutput = getBusBuffer(buffer, true, 0);
     
-    auto totalNumInputChannels = getTotalNumInputChannels();
+    auto totalNumInputChannels = mainInputOutput.getNumChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto numSamples = buffer.getNumSamples();
     /***************************************************************************************/
-    // 1. Fill a new array here with upsampled input
-    //      a. zeros array of size buffer*N
-    //      b. assign input value to every N'th sample in the zeros array
-    // 2. Apply low pass
-    // 3. Run the VCF
-    // 4. Apply low pass again 
-    // 5. For loop to downsample
+    // For every sub-block of the host's buffer:
+    // 1. Upsample, through the half-band anti-imaging filters of the oversampler
+    // 2. Run the VCF in place on the oversampled sub-block
+    // 3. Downsample, through the half-band anti-aliasing filters of the oversampler
+
+    // the governor's level follows from the load of the blocks before this one
+    governing = governorEnabled.load() && ! isNonRealtime();
+
+    if (! governing)
+        governor.reset();
+
+    auto level = governor.getLevel();
+    auto stages = oversamplingStages.load();
+    auto isLinearPhase = linearPhase.load();
+    auto governedStages = level >= QualityGovernor::lowerOversampling ? juce::jmax(0, stages - 1) : stages;
+    auto tolerance = level >= QualityGovernor::looseTolerance ? err * QualityGovernor::looserTolerance : err;
+    activeQuality = level >= QualityGovernor::fastTanh ? (int) Nonlinearities::Quality::table : quality.load();
+
+    auto& engine = getEngine<SampleType>();
+    juce::dsp::AudioBlock<SampleType> blockInput(mainInputOutput);
+
+    // The output is delayed to the latency of the selected setting, which is the one the host
+    // compensates, and so is the bypassed input. It is worked out here rather than read back
+    // from getLatencySamples(), which handleAsyncUpdate only updates later.
+    auto latency = getResamplerLatency(engine, stages, isLinearPhase);
+
+    // a host bypass fades over to the delayed input, and a block that finds it faded over runs nothing else
+    bypassMix.setTargetValue(bypass ? 1.0 : 0.0);
+    auto fading = bypassMix.isSmoothing();
+
+    if (bypass && ! fading)
+    {
+        if (engine.activeResampler != nullptr)
+            resetForBypass(engine);
+
+        delayDry(engine, blockInput, blockInput, latency);
+        ++solverStats.bypassedBlocks;
+        publishTelemetry(startTicks, numSamples, 1);
+        return;
+    }
+
+    // the first block back from a bypass finds no active resampler, so it starts its filters and coefficients afresh
+    auto resuming = engine.activeResampler == nullptr;
+    auto& resampler = *engine.resamplers[(size_t) getResamplerIndex(governedStages, isLinearPhase)];
+    auto resamplerChanged = &resampler != engine.activeResampler;
+    auto factor = (int) resampler.oversampling->getOversamplingFactor();
 
-    I0 = 2.0 * Fs * std::tan(2.0 * 3.14 * controlledF0 / Fs / 2.0) * 8.0 * C * controlledVt; // slider controls the f0
-    gamma = eta * controlledVt;
+    // A new factor, whether the governor or the user picked it, starts its filters from silence
+    // and crossfades from the outgoing one over the first sub-block, which hides their start.
+    // The ladder state carries over to it.
+    Resampler<SampleType>* outgoing = nullptr;
+
+    if (resamplerChanged)
+    {
+        outgoing = engine.activeResampler;
+        resampler.oversampling->reset();
+        engine.activeResampler = &resampler;
+    }
+
+    // the solver runs at the oversampled rate
+    Fs = hostFs * (double) factor;
+    T = 1 / Fs;
+
+    smoothedK.setTarget(controlledK.load(), parameterRampSamples);
+    smoothedOctave.setTarget(std::log2(controlledF0.load()), parameterRampSamples);
+    smoothedVt.setTarget(controlledVt.load(), parameterRampSamples);
+
+    // back from a bypass, the parameters start where they are now rather than where they were left
+    if (resuming)
+    {
+        smoothedK.reset(controlledK.load());
+        smoothedOctave.reset(std::log2(controlledF0.load()));
+        smoothedVt.reset(controlledVt.load());
+    }
 
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear(i, 0, buffer.getNumSamples());
+        mainInputOutput.clear(i, 0, mainInputOutput.getNumSamples());
 
+    // switching modes starts every ladder and voice from rest
+    if (polyphonic.load() != activePolyphonic)
+    {
+        voices.reset();
+
+        for (auto& state : engine.voiceStates)
+            state.reset();
 
-    juce::dsp::AudioBlock<float> blockInput(buffer);
-    juce::dsp::AudioBlock<float> blockOutput = oversampling->processSamplesUp(blockInput);
+        for (auto& state : engine.ladderStates)
+            state.reset();
 
-    updateFilter();
-    lowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(blockOutput));
-    for (int channel = 0; channel < blockOutput.getNumChannels(); ++channel)
+        activePolyphonic = ! activePolyphonic;
+    }
+
+    auto voicesRinging = false;
+
+    if (activePolyphonic)
+        for (int group = 0; group < voices.getNumGroups(); ++group)
+            voicesRinging = voicesRinging || (voices.isGroupActive(group) && ! engine.voiceStates[(size_t) group].isBelow(stateThreshold));
+
+    if (updateIdleGroups(mainInputOutput) && ! voicesRinging)
     {
-        for (int sample = 0; sample < blockOutput.getNumSamples(); ++sample)
+        // Nothing to ring out: the resampling filters were cleared when the last group
+        // went idle, so the output is exactly silent until input comes back.
+        if (! idle)
         {
-            vin = blockOutput.getSample(channel, sample);
-            vc4Temp = 0.0;
-            vc4Past = 1.0;
+            resampler.oversampling->reset();
+            idle = true;
+        }
+
+        auto vt = advanceParameters(numSamples);
+
+        // notes still come and go, they just have nothing to filter yet
+        if (activePolyphonic)
+        {
+            voices.beginBlock(std::log2(f0 / Fs), vt, Fs, numSamples * factor);
+
+            for (const auto metadata : midi)
+                handleVoiceMessage(metadata.getMessage(), metadata.samplePosition * factor);
+
+            voices.skipBlock();
+            voices.freeDecayed(engine.voiceStates.data(), stateThreshold);
+        }
+
+        // the delay line still takes the input, in case the bypass comes in next
+        delayDry(engine, blockInput, blockInput, latency);
 
-            while (std::abs(vc4Temp - vc4Past) > std::abs(vc4Past) * err)
+        if (fading)
+        {
+            for (size_t i = 0; i < blockInput.getNumSamples(); ++i)
             {
-                vc4Past = vc4Temp;
+                auto dryWeight = (SampleType) bypassMix.getNextValue();
+
+                for (size_t channel = 0; channel < blockInput.getNumChannels(); ++channel)
+                    blockInput.getChannelPointer(channel)[i] *= dryWeight;
+            }
+        }
+        else
+        {
+            mainInputOutput.clear();
+        }
+
+        ladderCoefficients = targetCoefficients;
+        ++solverStats.idleBlocks;
+        publishTelemetry(startTicks, numSamples, factor);
+        return;
+    }
+
+    idle = false;
+
+    // a stage the new order did not use last block starts from rest
+    auto order = ladderOrder.load();
+
+    if (order != activeOrder)
+    {
+        for (auto& state : engine.ladderStates)
+            state.resetStagesFrom(juce::jmin(order, activeOrder));
 
-                vin1Temp = std::tanh((vin - voutTemp) / (2.0 * Vt));
+        for (auto& state : engine.voiceStates)
+            state.resetStagesFrom(juce::jmin(order, activeOrder));
+
+        activeOrder = order;
+    }
+
+    auto fixed = fixedCost.load() || level >= QualityGovernor::fixedCost;
+    auto ladderPredictor = static_cast<LadderPredictor> (predictor.load());
+    auto hasSidechain = getBusCount(true) > 1 && getChannelCountOfBus(true, 1) > 0;
+    auto sidechain = getBusBuffer(buffer, true, hasSidechain ? 1 : 0);
+
+    auto subBlockSize = juce::jmax(1, subBlockSamples / factor);
+
+    // a governed factor has less latency than the selected one, which is what the host compensates for
+    auto delay = juce::jmax(0, latency - juce::roundToInt(resampler.oversampling->getLatencyInSamples()));
+
+    // Upsamples one sub-block through a resampler, solves it at that resampler's rate and
+    // downsamples it in place. The parameters and the ladder move on by that sub-block.
+    auto runSubBlock = [&](Resampler<SampleType>& path, juce::dsp::AudioBlock<SampleType>& block, int start, bool snapCoefficients)
+    {
+        auto pathFactor = (int) path.oversampling->getOversamplingFactor();
+        auto numSubBlockSamples = (int) block.getNumSamples();
+        Fs = hostFs * (double) pathFactor;
+        T = 1 / Fs;
+
+        // Parameters are smoothed at the host rate and evaluated at the end of the
+        // sub-block; the solver constants then ramp linearly towards that point, so
+        // automation costs one tan per sub-block, the same as a static setting.
+        auto startK = K, startF0 = f0, startVt = gamma / eta;
+        auto vt = advanceParameters(numSubBlockSamples);
+
+        LadderCircuit::setCoefficients(targetCoefficients, f0, K, vt, Fs, tolerance); //controlledK = K in literature = gfdbk in MATLAB
+        targetCoefficients.setPredictor(ladderPredictor);
+
+        // a new oversampling factor changes the meaning of the constants, so that jumps straight to the target
+        if (snapCoefficients)
+        {
+            ladderCoefficients = targetCoefficients;
+            startF0 = f0;
+        }
 
-                xc1Temp = (I0 / 2.0 / C) * (vin1Temp + vc11Temp);
-                vc1Temp = T / 2.0 * xc1Temp + s1;
-                vc11Temp = std::tanh((vc2Temp - vc1Temp) / (2.0 * gamma));
+        ladderCoefficients.setPredictor(ladderPredictor);
+        coefficientRamp.set(ladderCoefficients, targetCoefficients, numSubBlockSamples * pathFactor);
 
-                xc2Temp = (I0 / 2.0 / C) * (vc21Temp - vc11Temp);
-                vc2Temp = T / 2.0 * xc2Temp + s2;
-                vc21Temp = std::tanh((vc3Temp - vc2Temp) / (2.0 * gamma));
+        const double* cutoffModulation = nullptr;
+        const double* feedbackModulation = nullptr;
 
-                xc3Temp = (I0 / 2.0 / C) * (vc31Temp - vc21Temp);
-                vc3Temp = T / 2.0 * xc3Temp + s3;
-                vc31Temp = std::tanh((vc4Temp - vc3Temp) / (2.0 * gamma));
+        if (hasSidechain)
+            updateModulation(sidechain, start, numSubBlockSamples, pathFactor,
+                             startF0, startK, startVt, vt, cutoffModulation, feedbackModulation);
 
-                xc4Temp = (I0 / 2.0 / C) * (-vc41Temp - vc31Temp);
-                vc4Temp = T / 2.0 * xc4Temp + s4;
-                vc41Temp = std::tanh(vc4Temp / (6.0 * gamma));
+        // the voices are tuned against the cutoff at the end of the sub-block, like the static coefficients
+        if (activePolyphonic)
+            voices.beginBlock(std::log2(f0 / Fs), vt, Fs, numSubBlockSamples * pathFactor);
 
-                voutTemp = vc4Temp / 2.0 + vc4Temp * controlledK; //controlledK = K in literature = gfdbk in MATLAB
+        auto subBlockOutput = path.oversampling->processSamplesUp(block);
+
+        switch (order)
+        {
+            case 2:  fixed ? processLadderOfOrder<ladderFixedIterations, 2>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation)
+                           : processLadderOfOrder<0, 2>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation); break;
+            case 6:  fixed ? processLadderOfOrder<ladderFixedIterations, 6>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation)
+                           : processLadderOfOrder<0, 6>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation); break;
+            case 8:  fixed ? processLadderOfOrder<ladderFixedIterations, 8>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation)
+                           : processLadderOfOrder<0, 8>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation); break;
+            case 4:
+            default: fixed ? processLadderOfOrder<ladderFixedIterations, 4>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation)
+                           : processLadderOfOrder<0, 4>(subBlockOutput, midi, start, pathFactor, cutoffModulation, feedbackModulation); break;
+        }
+
+        ladderCoefficients = targetCoefficients;
+        path.oversampling->processSamplesDown(block);
+    };
+
+    // the crossfade runs both factors over its sub-block, so that one is sized for the higher of them
+    auto numSubBlockSamples = 0;
+
+    for (int start = 0; start < numSamples; start += numSubBlockSamples)
+    {
+        auto maxSubBlockSamples = outgoing != nullptr ? subBlockSamples / juce::jmax(factor, (int) outgoing->oversampling->getOversamplingFactor())
+                                                      : subBlockSize;
+        numSubBlockSamples = juce::jmin(juce::jmax(1, maxSubBlockSamples), numSamples - start);
+        auto subBlockInput = blockInput.getSubBlock((size_t) start, (size_t) numSubBlockSamples);
+        auto dryBlock = juce::dsp::AudioBlock<SampleType>(engine.dryBlock).getSubBlock(0, (size_t) numSubBlockSamples);
+
+        // the input goes into the delay line before the solver overwrites it; the delayed copy is only mixed in while the bypass fades
+        delayDry(engine, subBlockInput, dryBlock, latency);
+
+        if (outgoing != nullptr)
+        {
+            // The outgoing resampler runs the sub-block first, on a copy of the input, and
+            // everything that moves on with it is put back afterwards, so the incoming one
+            // takes over from exactly where the previous sub-block left off.
+            auto outgoingBlock = juce::dsp::AudioBlock<SampleType>(engine.outgoingBlock).getSubBlock(0, (size_t) numSubBlockSamples);
+            outgoingBlock.copyFrom(subBlockInput);
+
+            std::copy(engine.ladderStates.begin(), engine.ladderStates.end(), engine.outgoingLadderStates.begin());
+            std::copy(engine.voiceStates.begin(), engine.voiceStates.end(), engine.outgoingVoiceStates.begin());
+            std::copy(linearGroups.begin(), linearGroups.end(), outgoingLinearGroups.begin());
+            std::copy(outputPeaks.begin(), outputPeaks.end(), outgoingOutputPeaks.begin());
+            auto savedSmoothedK = smoothedK, savedSmoothedVt = smoothedVt;
+            auto savedSmoothedOctave = smoothedOctave;
+            auto savedK = K, savedF0 = f0, savedI0 = I0, savedGamma = gamma;
+            auto savedCv0 = lastCv[0], savedCv1 = lastCv[1];
+            auto savedCoefficients = ladderCoefficients;
+            auto savedVoices = voices;
+            auto savedStats = solverStats;
+
+            runSubBlock(*outgoing, outgoingBlock, start, false);
+
+            std::copy(engine.outgoingLadderStates.begin(), engine.outgoingLadderStates.end(), engine.ladderStates.begin());
+            std::copy(engine.outgoingVoiceStates.begin(), engine.outgoingVoiceStates.end(), engine.voiceStates.begin());
+            std::copy(outgoingLinearGroups.begin(), outgoingLinearGroups.end(), linearGroups.begin());
+            std::copy(outgoingOutputPeaks.begin(), outgoingOutputPeaks.end(), outputPeaks.begin());
+            smoothedK = savedSmoothedK;
+            smoothedVt = savedSmoothedVt;
+            smoothedOctave = savedSmoothedOctave;
+            K = savedK;
+            f0 = savedF0;
+            I0 = savedI0;
+            gamma = savedGamma;
+            lastCv[0] = savedCv0;
+            lastCv[1] = savedCv1;
+            ladderCoefficients = savedCoefficients;
+            voices = savedVoices;
+            solverStats = savedStats;
+
+            runSubBlock(resampler, subBlockInput, start, true);
+
+            // each output is delayed to the selected latency from its own, over the same samples of the line
+            auto position = engine.delayPosition;
+            delayOutput(engine, outgoingBlock, engine.delaySamples);
+            engine.delayPosition = position;
+            engine.delaySamples = delay;
+            delayOutput(engine, subBlockInput, delay);
+
+            auto fadeStep = 1.0 / numSubBlockSamples;
+
+            for (size_t channel = 0; channel < juce::jmin(subBlockInput.getNumChannels(), outgoingBlock.getNumChannels()); ++channel)
+            {
+                auto* from = outgoingBlock.getChannelPointer(channel);
+                auto* to = subBlockInput.getChannelPointer(channel);
+
+                for (int i = 0; i < numSubBlockSamples; ++i)
+                    to[i] = from[i] + (SampleType) ((i + 1) * fadeStep) * (to[i] - from[i]);
+            }
+
+            outgoing = nullptr;
+        }
+        else
+        {
+            runSubBlock(resampler, subBlockInput, start, resamplerChanged);
+            delayOutput(engine, subBlockInput, delay);
+        }
+
+        resamplerChanged = false;
+
+        if (fading)
+        {
+            for (size_t i = 0; i < subBlockInput.getNumSamples(); ++i)
+            {
+                auto dryWeight = (SampleType) bypassMix.getNextValue();
+
+                for (size_t channel = 0; channel < subBlockInput.getNumChannels(); ++channel)
+                {
+                    auto& output = subBlockInput.getChannelPointer(channel)[i];
+                    output += dryWeight * (dryBlock.getChannelPointer(channel)[i] - output);
+                }
             }
-            //updates
-            vin1 = vin1Temp;
-            xc1 = xc1Temp;
-            xc2 = xc2Temp;
-            xc3 = xc3Temp;
-            xc4 = xc4Temp;
-            vc1 = vc1Temp;
-            vc2 = vc2Temp;
-            vc3 = vc3Temp;
-            vc4 = vc4Temp;
-            vc11 = vc11Temp;
-            vc21 = vc21Temp;
-            vc31 = vc31Temp;
-            vc41 = vc41Temp;
-            vout = voutTemp;
-
-            s1 = T / 2 * xc1 + vc1;
-            s2 = T / 2 * xc2 + vc2;
-            s3 = T / 2 * xc3 + vc3;
-            s4 = T / 2 * xc4 + vc4;
-            blockOutput.setSample(channel, sample, vout);
         }
     }
-    updateFilter();
-    lowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(blockOutput));
 
-    oversampling->processSamplesDown(blockInput);
+    // events a host placed past the end of the block still have to release their notes, at the end of the last sub-block
+    if (activePolyphonic)
+        for (auto event = midi.findNextSamplePosition(numSamples); event != midi.cend(); ++event)
+            handleVoiceMessage((*event).getMessage(), numSubBlockSamples * factor);
 
-    //updateFilter(1);
-    //lowPassFilter.process(juce::dsp::ProcessContextReplacing<float>(blockOutput));
+    publishTelemetry(startTicks, numSamples, factor);
 }
 //==============================================================================
 bool VCFAudioProcessor::hasEditor() const
 {
-    return true; // (change this to false if you choose to not supply an editor)
+    return ! VCF_HEADLESS; // (change this to false if you choose to not supply an editor)
 }
 void VCFAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
     //Parameters update  when sliders moved
     if (parameterID == "controlK_ID") {
         controlledK = newValue;
+        triggerAsyncUpdate();
     }
     else if (parameterID == "controlF0_ID") {
         controlledF0 = newValue;
+        triggerAsyncUpdate();
     }
     else if (parameterID == "controlVt_ID") {
-        controlledVt = newValue;
+        // the range starts at zero, which would leave the stages no gain at all
+        controlledVt = juce::jmax(LadderCircuit::minControlVoltage, (double) newValue);
+        triggerAsyncUpdate();
+    }
+    else if (parameterID == "quality_ID") {
+        quality = (int) newValue;
+    }
+    else if (parameterID == "oversampling_ID") {
+        oversamplingStages = juce::jlimit(0, maxOversamplingStages, (int) newValue);
+        triggerAsyncUpdate();
+    }
+    else if (parameterID == "oversamplingFilter_ID") {
+        linearPhase = newValue > 0.5f;
+        triggerAsyncUpdate();
+    }
+    else if (parameterID == "cvCutoffDepth_ID") {
+        cvCutoffDepth = newValue;
+    }
+    else if (parameterID == "cvFeedbackDepth_ID") {
+        cvFeedbackDepth = newValue;
+    }
+    else if (parameterID == "eco_ID") {
+        eco = newValue > 0.5f;
+    }
+    else if (parameterID == "solver_ID") {
+        fixedCost = newValue > 0.5f;
+    }
+    else if (parameterID == "order_ID") {
+        ladderOrder = 2 * (juce::jlimit(0, 3, (int) newValue) + 1);
+        triggerAsyncUpdate();
+    }
+    else if (parameterID == "poly_ID") {
+        polyphonic = newValue > 0.5f;
+    }
+    else if (parameterID == "governor_ID") {
+        governorEnabled = newValue > 0.5f;
+    }
+    else if (parameterID == "link_ID") {
+        linkChannels = newValue > 0.5f;
     }
 }
-void VCFAudioProcessor::updateFilter()
+void VCFAudioProcessor::handleAsyncUpdate()
 {
-    float frequency = 48e3 * 4;
+    // The host is told about the new latency from the message thread, since
+    // setLatencySamples() notifies its listeners under a lock. The tail is
+    // simulated here too, away from the audio thread.
+    auto index = (size_t) getResamplerIndex(oversamplingStages.load(), linearPhase.load());
+
+    if (auto& resampler = floatEngine.resamplers[index])
+        setLatencySamples(juce::roundToInt(resampler->oversampling->getLatencyInSamples()));
+    else if (auto& doubleResampler = doubleEngine.resamplers[index])
+        setLatencySamples(juce::roundToInt(doubleResampler->oversampling->getLatencyInSamples()));
+
+    tailSeconds = computeTailSeconds(controlledK.load(), controlledF0.load(), controlledVt.load(), ladderOrder.load());
+}
+template <typename SampleType>
+bool VCFAudioProcessor::updateIdleGroups(const juce::AudioBuffer<SampleType>& input)
+{
+    // the input has to stay silent for long enough to have left the up- and downsampling filters
+    auto hold = 2 * getLatencySamples() + idleHoldSamples;
+    auto numChannels = juce::jmin(input.getNumChannels(), (int) silentSamples.size());
+    auto numSamples = input.getNumSamples();
+    auto allIdle = true;
+
+    constexpr auto numLanes = Engine<SampleType>::numLanes;
+    auto& ladderStates = getEngine<SampleType>().ladderStates;
+
+    for (int group = 0; group < (int) ladderStates.size(); ++group)
+    {
+        auto groupSilent = true;
+
+        for (int channel = group * numLanes; channel < juce::jmin(numChannels, (group + 1) * numLanes); ++channel)
+        {
+            auto* data = input.getReadPointer(channel);
+            auto trailing = 0;
+
+            while (trailing < numSamples && std::abs(data[numSamples - 1 - trailing]) < (SampleType) silenceThreshold)
+                ++trailing;
+
+            auto& silent = silentSamples[(size_t) channel];
+            groupSilent = groupSilent && trailing == numSamples && silent >= hold;
+            silent = trailing == numSamples ? juce::jmin(silent + numSamples, std::numeric_limits<int>::max() / 2) : trailing;
+        }
 
-    *lowPassFilter.state = *juce::dsp::IIR::Coefficients<float>::makeLowPass(frequency, frequency / 4);
+        auto& state = ladderStates[(size_t) group];
+        auto groupIdle = groupSilent && (idleGroups[(size_t) group] != 0 || state.isBelow(stateThreshold));
+
+        // a group that goes idle starts again from an exactly cleared state
+        if (groupIdle && idleGroups[(size_t) group] == 0)
+            state.reset();
+
+        idleGroups[(size_t) group] = groupIdle ? 1 : 0;
+        allIdle = allIdle && groupIdle;
+    }
+
+    return allIdle;
 }
+template <typename SampleType>
+void VCFAudioProcessor::delayOutput(Engine<SampleType>& engine, const juce::dsp::AudioBlock<SampleType>& output, int delay)
+{
+    // Like the bypass line, this one always holds the last output samples, so a new delay only
+    // moves the point it is read at. The sub-block that moves it reads at both points and
+    // crossfades from the old one to the new one, rather than starting the line from silence.
+    auto length = engine.latencyDelay.getNumSamples();
+    auto previous = juce::jlimit(0, length - 1, engine.delaySamples);
+    delay = juce::jlimit(0, length - 1, delay);
+
+    auto numChannels = juce::jmin((int) output.getNumChannels(), engine.latencyDelay.getNumChannels());
+    auto numSamples = (int) output.getNumSamples();
+    auto fadeStep = 1.0 / juce::jmax(1, numSamples);
 
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* data = output.getChannelPointer((size_t) channel);
+        auto* line = engine.latencyDelay.getWritePointer(channel);
+
+        for (int i = 0, position = engine.delayPosition; i < numSamples; ++i)
+        {
+            line[position] = data[i];
+            auto delayed = line[position >= delay ? position - delay : position - delay + length];
+
+            if (previous != delay)
+            {
+                auto before = line[position >= previous ? position - previous : position - previous + length];
+                delayed = before + (SampleType) ((i + 1) * fadeStep) * (delayed - before);
+            }
+
+            data[i] = delayed;
+            position = position + 1 < length ? position + 1 : 0;
+        }
+    }
+
+    engine.delaySamples = delay;
+    engine.delayPosition = (engine.delayPosition + numSamples) % length;
+}
+template <typename SampleType>
+void VCFAudioProcessor::delayDry(Engine<SampleType>& engine, const juce::dsp::AudioBlock<SampleType>& input,
+                                 const juce::dsp::AudioBlock<SampleType>& output, int delay)
+{
+    // The line always holds the last samples of the input, whatever the latency, so a new
+    // oversampling setting only moves the point it is read at. Each sample is written
+    // before the delayed one is read, which lets output be the input itself.
+    auto length = engine.dryDelay.getNumSamples();
+    delay = juce::jlimit(0, length - 1, delay);
+    auto numChannels = juce::jmin((int) input.getNumChannels(), engine.dryDelay.getNumChannels());
+    auto numSamples = (int) input.getNumSamples();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* source = input.getChannelPointer((size_t) channel);
+        auto* destination = output.getChannelPointer((size_t) channel);
+        auto* line = engine.dryDelay.getWritePointer(channel);
+
+        for (int i = 0, position = engine.dryPosition; i < numSamples; ++i)
+        {
+            line[position] = source[i];
+            destination[i] = line[position >= delay ? position - delay : position - delay + length];
+            position = position + 1 < length ? position + 1 : 0;
+        }
+    }
+
+    engine.dryPosition = (engine.dryPosition + numSamples) % length;
+}
+template <typename SampleType>
+void VCFAudioProcessor::resetForBypass(Engine<SampleType>& engine)
+{
+    // everything the filtered path keeps goes back to rest, the way prepareToPlay leaves it
+    for (auto& state : engine.ladderStates)
+        state.reset();
+
+    for (auto& state : engine.voiceStates)
+        state.reset();
+
+    voices.reset();
+
+    std::fill(silentSamples.begin(), silentSamples.end(), 0);
+    std::fill(idleGroups.begin(), idleGroups.end(), (char) 0);
+    std::fill(linearGroups.begin(), linearGroups.end(), (char) 0);
+    std::fill(outputPeaks.begin(), outputPeaks.end(), 0.0);
+    idle = false;
+    lastCv[0] = lastCv[1] = 0.0;
+
+    engine.latencyDelay.clear();
+    engine.delaySamples = engine.delayPosition = 0;
+
+    // the block that comes back resets the filters of whichever resampler it picks
+    engine.activeResampler = nullptr;
+}
+double VCFAudioProcessor::advanceParameters(int numSamples)
+{
+    // the smoothed parameters after numSamples more host samples, and the solver constants they give
+    K = smoothedK.skip(numSamples);
+    f0 = std::exp2(smoothedOctave.skip(numSamples));
+    auto vt = smoothedVt.skip(numSamples);
+
+    I0 = LadderCircuit::getBiasCurrent(f0, vt, Fs); // slider controls the f0
+    gamma = eta * vt;
+    return vt;
+}
+double VCFAudioProcessor::computeTailSeconds(double k, double cutoff, double vt, int order) const
+{
+    // Rings a small impulse, well inside the linear region, through the ladder itself and
+    // measures how long the output takes to fall 120 dB below its peak. A ladder that is
+    // still ringing after maxTailSeconds is treated as self-oscillating.
+    auto rate = juce::jmax(8000.0, 16.0 * cutoff);
+    vt = juce::jmax(vt, LadderCircuit::minControlVoltage);
+
+    LadderCoefficients coefficients;
+    LadderCircuit::setCoefficients(coefficients, cutoff, k, vt, rate, err);
+
+    LadderState<1, double, ladderMaxOrder> state;
+    state.reset();
+
+    auto window = (int) (4.0 * rate / cutoff); // a few periods, so zero crossings don't count as decayed
+    auto maxSamples = (int) (maxTailSeconds * rate);
+    auto vin = 1.0e-3, vout = 0.0, peak = 0.0;
+    auto lastAudible = 0;
+    bool converged;
+
+    for (int n = 0; n < maxSamples && n - lastAudible < window; ++n)
+    {
+        switch (order)
+        {
+            case 2:  LadderSolver<Nonlinearities::ExactTanh, 1, double, 0, 2>::processSample(coefficients, state, &vin, &vout, converged); break;
+            case 6:  LadderSolver<Nonlinearities::ExactTanh, 1, double, 0, 6>::processSample(coefficients, state, &vin, &vout, converged); break;
+            case 8:  LadderSolver<Nonlinearities::ExactTanh, 1, double, 0, 8>::processSample(coefficients, state, &vin, &vout, converged); break;
+            case 4:
+            default: LadderSolver<Nonlinearities::ExactTanh, 1, double, 0, 4>::processSample(coefficients, state, &vin, &vout, converged); break;
+        }
+
+        vin = 0.0;
+
+        peak = juce::jmax(peak, std::abs(vout));
+
+        if (std::abs(vout) > 1.0e-6 * peak)
+            lastAudible = n;
+    }
+
+    if (maxSamples - lastAudible <= window)
+        return std::numeric_limits<double>::infinity();
+
+    return (lastAudible + 1) / rate;
+}
+template <typename SampleType>
+void VCFAudioProcessor::updateModulation(const juce::AudioBuffer<SampleType>& sidechain, int startSample, int numSamples, int factor,
+                                         double startF0, double startK, double startVt, double endVt,
+                                         const double*& cutoffModulation, const double*& feedbackModulation)
+{
+    // Channel 0 of the sidechain is the cutoff CV in octaves per unit of cvCutoffDepth_ID,
+    // channel 1 (or channel 0 on a mono sidechain) adds cvFeedbackDepth_ID per unit to K.
+    // Both are linearly interpolated up to the solver rate, and ramp from the previous
+    // sub-block's parameter values like the static coefficients do.
+    auto numSolverSamples = numSamples * factor;
+
+    if (numSolverSamples > (int) modulatedA.size())
+    {
+        jassertfalse; // sub-block longer than subBlockSamples
+        return;
+    }
+
+    auto upsample = [numSamples, factor](const SampleType* cv, double& last, double* destination)
+    {
+        for (int i = 0, n = 0; i < numSamples; ++i)
+        {
+            auto step = ((double) cv[i] - last) / factor;
+
+            for (int j = 0; j < factor; ++j)
+                destination[n++] = (last += step);
+        }
+    };
+
+    auto scale = 1.0 / numSolverSamples;
+    auto cutoffDepth = cvCutoffDepth.load();
+    auto feedbackDepth = cvFeedbackDepth.load();
+
+    if (cutoffDepth != 0.0)
+    {
+        upsample(sidechain.getReadPointer(0, startSample), lastCv[0], modulatedA.data());
+
+        auto startOctave = std::log2(startF0 / Fs), octaveStep = (std::log2(f0 / Fs) - startOctave) * scale;
+        auto vtStep = (endVt - startVt) * scale;
+        auto* a = modulatedA.data();
+
+        // a = T I0 / (4 C) = 4 Vt tan (pi f0 / Fs)
+        for (int n = 0; n < numSolverSamples; ++n)
+            a[n] = 4.0 * (startVt + vtStep * (n + 1)) * CutoffTable::tanOfOctave(startOctave + octaveStep * (n + 1) + cutoffDepth * a[n]);
+
+        cutoffModulation = a;
+    }
+
+    if (feedbackDepth != 0.0)
+    {
+        auto channel = juce::jmin(1, sidechain.getNumChannels() - 1);
+        upsample(sidechain.getReadPointer(channel, startSample), lastCv[1], modulatedGain.data());
+
+        auto kStep = (K - startK) * scale;
+        auto* gain = modulatedGain.data();
+
+        for (int n = 0; n < numSolverSamples; ++n)
+            gain[n] = 0.5 + juce::jlimit(0.0, 4.0, startK + kStep * (n + 1) + feedbackDepth * gain[n]);
+
+        feedbackModulation = gain;
+    }
+}
+template <int fixedIterations, int order, typename SampleType>
+void VCFAudioProcessor::processLadderOfOrder(juce::dsp::AudioBlock<SampleType>& block, const juce::MidiBuffer& midi, int hostStart, int factor,
+                                             const double* cutoffModulation, const double* feedbackModulation)
+{
+    if (activePolyphonic)
+    {
+        switch (static_cast<Nonlinearities::Quality> (activeQuality))
+        {
+            case Nonlinearities::Quality::pade:        processVoices<Nonlinearities::PadeTanh, fixedIterations, order>(block, midi, hostStart, factor, feedbackModulation); break;
+            case Nonlinearities::Quality::table:       processVoices<Nonlinearities::TableTanh, fixedIterations, order>(block, midi, hostStart, factor, feedbackModulation); break;
+            case Nonlinearities::Quality::antialiased: processVoices<Nonlinearities::AntialiasedTanh, fixedIterations, order>(block, midi, hostStart, factor, feedbackModulation); break;
+            case Nonlinearities::Quality::exact:
+            default:                                   processVoices<Nonlinearities::ExactTanh, fixedIterations, order>(block, midi, hostStart, factor, feedbackModulation); break;
+        }
+    }
+    else
+    {
+        switch (static_cast<Nonlinearities::Quality> (activeQuality))
+        {
+            case Nonlinearities::Quality::pade:        processLadder<Nonlinearities::PadeTanh, fixedIterations, order>(block, cutoffModulation, feedbackModulation); break;
+            case Nonlinearities::Quality::table:       processLadder<Nonlinearities::TableTanh, fixedIterations, order>(block, cutoffModulation, feedbackModulation); break;
+            case Nonlinearities::Quality::antialiased: processLadder<Nonlinearities::AntialiasedTanh, fixedIterations, order>(block, cutoffModulation, feedbackModulation); break;
+            case Nonlinearities::Quality::exact:
+            default:                                   processLadder<Nonlinearities::ExactTanh, fixedIterations, order>(block, cutoffModulation, feedbackModulation); break;
+        }
+    }
+}
+template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+void VCFAudioProcessor::processLadder(juce::dsp::AudioBlock<SampleType>& block, const double* cutoffModulation, const double* feedbackModulation)
+{
+    // The groups share nothing but read-only constants, so a long enough block with
+    // several of them goes to the worker pool. Each group counts into its own stats,
+    // which are only added up once all of them are done.
+    auto numGroups = (int) getEngine<SampleType>().ladderStates.size();
+
+    auto processGroup = [&](int group)
+    {
+        processLadderGroup<Nonlinearity, fixedIterations, order>(block, group, cutoffModulation, feedbackModulation, groupStats[(size_t) group]);
+    };
+
+    if (workerPool != nullptr && numGroups > 1 && (int) block.getNumSamples() >= minParallelSamples)
+        workerPool->run(numGroups, processGroup);
+    else
+        for (int group = 0; group < numGroups; ++group)
+            processGroup(group);
+
+    for (auto& stats : groupStats)
+    {
+        solverStats.addCounters(stats);
+        stats = {};
+    }
+}
+template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+void VCFAudioProcessor::processLadderGroup(juce::dsp::AudioBlock<SampleType>& block, int group, const double* cutoffModulation,
+                                           const double* feedbackModulation, SolverStats& stats)
+{
+    constexpr auto ladderLanes = Engine<SampleType>::numLanes;
+    auto& state = getEngine<SampleType>().ladderStates[(size_t) group];
+    auto numChannels = (int) block.getNumChannels();
+    auto numSamples = (int) block.getNumSamples();
+
+    SampleType* channelData[ladderLanes] = {};
+    auto numLanes = juce::jmin(ladderLanes, numChannels - group * ladderLanes);
+
+    for (int lane = 0; lane < numLanes; ++lane)
+        channelData[lane] = block.getChannelPointer((size_t) (group * ladderLanes + lane));
+
+    // silent input into a rung-out ladder gives silence, without solving
+    if (idleGroups[(size_t) group] != 0)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+            juce::FloatVectorOperations::clear(channelData[lane], numSamples);
+
+        return;
+    }
+
+    // The drive is estimated against the coefficients at the end of the block. CV
+    // modulation moves them within the block, so a modulated group stays nonlinear.
+    auto& linearGroup = linearGroups[(size_t) group];
+    auto linear = linearGroup != 0;
+    auto useLinear = false;
+
+    if (eco.load())
+    {
+        auto inputPeak = 0.0;
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(channelData[lane], numSamples);
+            inputPeak = juce::jmax(inputPeak, (double) -range.getStart(), (double) range.getEnd());
+        }
+
+        auto drive = LinearLadderSolver<ladderLanes>::estimateDrive(targetCoefficients, inputPeak,
+                                                                    outputPeaks[(size_t) group], (double) state.getPeak());
+        auto modulated = cutoffModulation != nullptr || feedbackModulation != nullptr;
+        useLinear = ! modulated && drive < LinearLadderSolver<ladderLanes>::maxDrive * (linear ? 1.0 : ecoHysteresis);
+    }
+
+    // a block that switches runs both ladders, the linear one on a copy of the state
+    auto switching = useLinear != linear;
+    typename Engine<SampleType>::State linearCopy;
+
+    if (switching)
+        linearCopy = state;
+
+    auto& linearState = switching ? linearCopy : state;
+    auto fadeStep = 1.0 / numSamples;
+
+    // Linked: the channels of the group carry the same signal, within linkThreshold, into
+    // lanes that hold the same state, as dual-mono or a centred source does. The ladder is
+    // then solved on a single lane and its output copied to the others, which saves the
+    // tanh evaluations of every other lane. Both are checked again on every sub-block,
+    // so the group goes back to solving each lane as soon as the channels diverge.
+    auto linked = linkChannels.load() && numLanes > 1 && ! linear && ! useLinear
+                  && state.lanesMatch(numLanes, stateThreshold);
+
+    for (int lane = 1; linked && lane < numLanes; ++lane)
+        for (int sample = 0; linked && sample < numSamples; ++sample)
+            linked = std::abs(channelData[lane][sample] - channelData[0][sample]) <= (SampleType) linkThreshold;
+
+    // all channels of the group go through the solver together, unused lanes see silence
+    SampleType vin[ladderLanes] = {}, vout[ladderLanes], linearOut[ladderLanes];
+    bool converged;
+    auto coefficients = ladderCoefficients;
+
+    if (linked)
+    {
+        LadderState<1, SampleType, ladderMaxOrder> linkedState;
+        linkedState.copyLane(0, state, 0);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            if (coefficientRamp.active)
+                coefficientRamp.apply(coefficients);
+
+            if (cutoffModulation != nullptr)
+                coefficients.a = cutoffModulation[sample];
+
+            if (feedbackModulation != nullptr)
+                coefficients.outputGain = feedbackModulation[sample];
+
+            auto iterations = LadderSolver<Nonlinearity, 1, SampleType, fixedIterations, order, ladderResponse>::processSample(coefficients, linkedState, channelData[0] + sample, vout, converged);
+            stats.iterations += (juce::uint64) iterations;
+            stats.tanhCalls += (juce::uint64) (iterations * (order + 1));
+            stats.nonConverged += converged ? 0 : 1;
+            ++stats.iterationHistogram[iterations];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                channelData[lane][sample] = vout[0];
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+            state.copyLane(lane, linkedState, 0);
+
+        stats.linkedSamples += (juce::uint64) numSamples;
+    }
+    else
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+                vin[lane] = channelData[lane][sample];
+
+            if (coefficientRamp.active)
+                coefficientRamp.apply(coefficients);
+
+            if (cutoffModulation != nullptr)
+                coefficients.a = cutoffModulation[sample];
+
+            if (feedbackModulation != nullptr)
+                coefficients.outputGain = feedbackModulation[sample];
+
+            if (! linear || switching)
+            {
+                auto iterations = LadderSolver<Nonlinearity, ladderLanes, SampleType, fixedIterations, order, ladderResponse>::processSample(coefficients, state, vin, vout, converged);
+                stats.iterations += (juce::uint64) iterations;
+                stats.tanhCalls += (juce::uint64) (iterations * (order + 1) * ladderLanes);
+                stats.nonConverged += converged ? 0 : 1;
+                ++stats.iterationHistogram[iterations];
+            }
+
+            if (linear || switching)
+                LinearLadderSolver<ladderLanes, SampleType, order, ladderResponse>::processSample(coefficients, linearState, vin, linearOut);
+
+            if (switching)
+            {
+                auto linearWeight = (SampleType) (useLinear ? (sample + 1) * fadeStep : 1.0 - (sample + 1) * fadeStep);
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    channelData[lane][sample] = vout[lane] + linearWeight * (linearOut[lane] - vout[lane]);
+            }
+            else
+            {
+                auto* output = linear ? linearOut : vout;
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    channelData[lane][sample] = output[lane];
+            }
+        }
+    }
+
+    if (switching && useLinear)
+        state = linearCopy;
+
+    if (linear && ! switching)
+    {
+        stats.linearSamples += (juce::uint64) numSamples;
+        stats.iterationHistogram[0] += (juce::uint64) numSamples;
+    }
+
+    linearGroup = useLinear ? 1 : 0;
+
+    if (eco.load())
+    {
+        auto outputPeak = 0.0;
+
+        // the drive estimate wants the lowpass that is fed back; a mixed output bounds it by the stages instead
+        if constexpr (ladderResponse == LadderResponse::lowpass)
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto range = juce::FloatVectorOperations::findMinAndMax(channelData[lane], numSamples);
+                outputPeak = juce::jmax(outputPeak, (double) -range.getStart(), (double) range.getEnd());
+            }
+        }
+        else
+        {
+            outputPeak = targetCoefficients.outputGain * (double) state.getPeak();
+        }
+
+        outputPeaks[(size_t) group] = outputPeak;
+    }
+
+    stats.samples += (juce::uint64) numSamples;
+}
+template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+void VCFAudioProcessor::processVoices(juce::dsp::AudioBlock<SampleType>& block, const juce::MidiBuffer& midi, int hostStart, int factor,
+                                      const double* feedbackModulation)
+{
+    // Every sounding voice filters every channel and the voices are summed. The sub-block,
+    // which starts at host sample hostStart, is split at its MIDI events, so each note
+    // starts and ends on its own sample. The voices are tuned by note rather than by the
+    // cutoff CV, and always run the nonlinear solver, since the eco mode's shared
+    // elimination needs a shared cutoff.
+    constexpr auto ladderLanes = Engine<SampleType>::numLanes;
+    auto& voiceStates = getEngine<SampleType>().voiceStates;
+    auto numChannels = juce::jmin((int) block.getNumChannels(), voices.getNumChannels());
+    auto numSamples = (int) block.getNumSamples();
+    auto hostEnd = hostStart + numSamples / factor;
+    auto coefficients = ladderCoefficients;
+    bool converged;
+
+    // events before the block belong to its first sample
+    auto event = hostStart == 0 ? midi.cbegin() : midi.findNextSamplePosition(hostStart);
+    auto hasEvent = [&] { return event != midi.cend() && (*event).samplePosition < hostEnd; };
+
+    SampleType* channelData[VoicePool::maxChannels] = {};
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channelData[channel] = block.getChannelPointer((size_t) channel);
+
+    // lane l of a group carries channel l % numChannels of one voice
+    int laneChannels[ladderLanes];
+
+    for (int lane = 0; lane < ladderLanes; ++lane)
+        laneChannels[lane] = lane % voices.getNumChannels();
+
+    for (int sample = 0; sample < numSamples;)
+    {
+        for (; hasEvent() && ((*event).samplePosition - hostStart) * factor <= sample; ++event)
+            handleVoiceMessage((*event).getMessage(), sample);
+
+        auto end = hasEvent() ? ((*event).samplePosition - hostStart) * factor : numSamples;
+
+        for (; sample < end; ++sample)
+        {
+            SampleType input[VoicePool::maxChannels] = {}, output[VoicePool::maxChannels] = {};
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                input[channel] = channelData[channel][sample];
+
+            if (coefficientRamp.active)
+                coefficientRamp.apply(coefficients);
+
+            if (feedbackModulation != nullptr)
+                coefficients.outputGain = feedbackModulation[sample];
+
+            for (int group = 0; group < voices.getNumGroups(); ++group)
+            {
+                if (! voices.isGroupActive(group))
+                    continue;
+
+                alignas(64) SampleType a[ladderLanes], gain[ladderLanes], vin[ladderLanes], vout[ladderLanes];
+                voices.advance(group, a, gain);
+
+                for (int lane = 0; lane < ladderLanes; ++lane)
+                    vin[lane] = gain[lane] * input[laneChannels[lane]];
+
+                auto iterations = LadderSolver<Nonlinearity, ladderLanes, SampleType, fixedIterations, order, ladderResponse>::processSample(coefficients, a, voiceStates[(size_t) group], vin, vout, converged);
+                solverStats.iterations += (juce::uint64) iterations;
+                solverStats.tanhCalls += (juce::uint64) (iterations * (order + 1) * ladderLanes);
+                solverStats.nonConverged += converged ? 0 : 1;
+                ++solverStats.iterationHistogram[iterations];
+                ++solverStats.samples;
+
+                for (int lane = 0; lane < ladderLanes; ++lane)
+                    output[laneChannels[lane]] += vout[lane];
+            }
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                channelData[channel][sample] = output[channel];
+        }
+    }
+
+    // the voices only cover the first VoicePool::maxChannels channels of a wider layout
+    for (int channel = numChannels; channel < (int) block.getNumChannels(); ++channel)
+        juce::FloatVectorOperations::clear(block.getChannelPointer((size_t) channel), numSamples);
+
+    voices.freeDecayed(voiceStates.data(), stateThreshold);
+}
+void VCFAudioProcessor::handleVoiceMessage(const juce::MidiMessage& message, int position)
+{
+    if (message.isNoteOn())
+        voices.noteOn(message.getNoteNumber(), message.getFloatVelocity(), position);
+    else if (message.isNoteOff())
+        voices.noteOff(message.getNoteNumber());
+    else if (message.isAllNotesOff() || message.isAllSoundOff())
+        voices.allNotesOff();
+}
+void VCFAudioProcessor::publishTelemetry(juce::int64 startTicks, int numSamples, int oversamplingFactor)
+{
+    auto busy = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    auto deadline = numSamples / hostFs;
+    auto load = deadline > 0.0 ? busy / deadline : 0.0;
+
+    solverStats.blocks += 1;
+    solverStats.overruns += load > 1.0 ? 1 : 0;
+    solverStats.busySeconds += busy;
+    solverStats.deadlineSeconds += deadline;
+    solverStats.maxLoad = juce::jmax(solverStats.maxLoad, load);
+    solverStats.sampleRate = hostFs;
+    solverStats.blockSize = numSamples;
+    solverStats.oversamplingFactor = oversamplingFactor;
+    solverStats.quality = activeQuality;
+    solverStats.voices = activePolyphonic ? voices.getNumActiveVoices() : 0;
+    solverStats.governorLevel = (int) governor.getLevel();
+
+    // the level this block ran at is published before the governor picks the next one
+    if (governing)
+        governor.update(load, deadline);
+
+    telemetry.publish(solverStats);
+}
+bool VCFAudioProcessor::startTelemetryLog(const juce::File& file)
+{
+    stopTelemetryLog();
+    telemetryLog.reset(new TelemetryLog(*this, file));
+
+    if (! telemetryLog->isOpen())
+        telemetryLog.reset();
+
+    return telemetryLog != nullptr;
+}
+void VCFAudioProcessor::stopTelemetryLog()
+{
+    telemetryLog.reset();
+}
 juce::AudioProcessorEditor* VCFAudioProcessor::createEditor()
 {
+   #if VCF_HEADLESS
+    return nullptr;
+   #else
     return new VCFAudioProcessorEditor (*this, audioTree);
+   #endif
 }
 
 //==============================================================================
 void VCFAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // every setting is a parameter of the tree, so the session stores the tree as XML
+    auto state = audioTree.copyState();
+
+    if (auto xml = state.createXml())
+        copyXmlToBinary(*xml, destData);
 }
 
 void VCFAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // Replacing the tree sets every parameter, which parameterChanged passes on as for
+    // automation. A parameter the saved state predates keeps its current value.
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+
+    if (xml != nullptr && xml->hasTagName(audioTree.state.getType()))
+        audioTree.replaceState(juce::ValueTree::fromXml(*xml));
 }
 
 //==============================================================================
@@ -9,12 +9,51 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LadderSolver.h"
+#include "CutoffTable.h"
+#include "SnapshotPublisher.h"
+#include "RealtimeCheck.h"
+#include "VoicePool.h"
+#include "WorkerPool.h"
+#include "QualityGovernor.h"
+
+// Default of the quality parameter, as a Nonlinearities::Quality index:
+// 0 = exact std::tanh, 1 = Pade approximation, 2 = interpolated table,
+// 3 = antiderivative-antialiased std::tanh (for 1x or 2x oversampling).
+#ifndef VCF_DEFAULT_TANH_QUALITY
+ #define VCF_DEFAULT_TANH_QUALITY 0
+#endif
+
+// Default of the oversampling parameter, as a number of 2x stages (0 = 1x ... 4 = 16x).
+#ifndef VCF_DEFAULT_OVERSAMPLING
+ #define VCF_DEFAULT_OVERSAMPLING 2
+#endif
+
+// Initial guess of the solver, as a LadderPredictor index:
+// 0 = previous solution, 1 = linear extrapolation, 2 = quadratic extrapolation.
+#ifndef VCF_DEFAULT_PREDICTOR
+ #define VCF_DEFAULT_PREDICTOR 2
+#endif
+
+// Output of the ladder, as a LadderResponse index: 0 = lowpass at the last stage,
+// 1 = highpass, 2 = bandpass, both mixed from the input and the stages (see LadderTaps).
+#ifndef VCF_LADDER_RESPONSE
+ #define VCF_LADDER_RESPONSE 0
+#endif
+
+// Set to 1 to build the processor without its editor, e.g. for the offline render tool.
+#ifndef VCF_HEADLESS
+ #define VCF_HEADLESS 0
+#endif
+
+class TelemetryLog;
 
 //==============================================================================
 /**
 */
 
-class VCFAudioProcessor  : public juce::AudioProcessor, public juce::AudioProcessorValueTreeState::Listener
+class VCFAudioProcessor  : public juce::AudioProcessor, public juce::AudioProcessorValueTreeState::Listener,
+                           private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -30,6 +69,10 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -57,24 +100,262 @@ public:
     //void setK(double val) { controlledK = val; };
     //void setVt(double val) { controlledF0 = val; };
     void parameterChanged(const juce::String& parameterID, float newValue);
-    void updateFilter();
-    std::unique_ptr<juce::dsp::Oversampling<float>> oversampling;
+
+    /** Solver counters accumulated by processBlock since the last resetSolverStats(). */
+    struct SolverStats
+    {
+        juce::uint64 samples = 0;       // oversampled samples, per group of channels solved side by side
+        juce::uint64 iterations = 0;    // Newton iterations over those samples
+        juce::uint64 nonConverged = 0;  // samples on which a lane hit the iteration cap
+        juce::uint64 tanhCalls = 0;     // tanh evaluations, counting every lane that was solved
+        juce::uint64 iterationHistogram[ladderMaxIterations + 1] = {}; // samples per iteration count
+        juce::uint64 linearSamples = 0; // samples the eco mode ran through the linear ladder, counted as 0 iterations
+        juce::uint64 linkedSamples = 0; // samples a group of identical channels solved on a single lane
+
+        juce::uint64 blocks = 0;        // processBlock calls
+        juce::uint64 overruns = 0;      // blocks that took longer than their own duration
+        juce::uint64 idleBlocks = 0;    // blocks that skipped oversampling and solving on silence
+        juce::uint64 bypassedBlocks = 0; // blocks the host bypassed, once faded over to the dry signal
+        double busySeconds = 0.0;       // wall time spent in processBlock
+        double deadlineSeconds = 0.0;   // audio time those blocks covered
+        double maxLoad = 0.0;           // highest busy / deadline ratio of a single block
+
+        // settings of the last block
+        double sampleRate = 0.0;
+        int blockSize = 0, oversamplingFactor = 0, quality = 0; // as run, after the governor
+        int voices = 0;                 // voices held or ringing in the polyphonic mode
+        int governorLevel = 0;          // QualityGovernor::Level, 0 at full quality
+
+        /** Adds the solver counters of another set, e.g. the ones counted for one group of channels. */
+        void addCounters (const SolverStats& other) noexcept
+        {
+            samples += other.samples;
+            iterations += other.iterations;
+            nonConverged += other.nonConverged;
+            tanhCalls += other.tanhCalls;
+            linearSamples += other.linearSamples;
+            linkedSamples += other.linkedSamples;
+
+            for (int i = 0; i <= ladderMaxIterations; ++i)
+                iterationHistogram[i] += other.iterationHistogram[i];
+        }
+
+        /** Highest iteration count any sample took between two snapshots, 0 if none were processed. */
+        static int getMaxIterations (const SolverStats& from, const SolverStats& to) noexcept
+        {
+            for (int i = ladderMaxIterations; i > 0; --i)
+                if (to.iterationHistogram[i] > from.iterationHistogram[i])
+                    return i;
+
+            return 0;
+        }
+    };
+
+    const SolverStats& getSolverStats() const noexcept { return solverStats; }
+    void setPredictor (LadderPredictor newPredictor) noexcept { predictor = (int) newPredictor; }
+    void resetSolverStats() noexcept { solverStats = {}; }
+
+    /** Caps the worker threads prepareToPlay sets up for the channel groups, e.g. at 0 when
+        several processors already run side by side on all cores. -1 means one per CPU.
+    */
+    void setMaxWorkers (int newMaxWorkers) noexcept { maxWorkers = newMaxWorkers; }
+
+    /** The solver counters as last published by the audio thread. Safe to call from any thread. */
+    SolverStats getTelemetry() const noexcept { return telemetry.read(); }
+
+    /** Starts appending the telemetry to a CSV file once a second, from a background thread. */
+    bool startTelemetryLog(const juce::File& file);
+    void stopTelemetryLog();
+
+    template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+    void processLadder(juce::dsp::AudioBlock<SampleType>& block, const double* cutoffModulation, const double* feedbackModulation);
+    template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+    void processLadderGroup(juce::dsp::AudioBlock<SampleType>& block, int group, const double* cutoffModulation,
+                            const double* feedbackModulation, SolverStats& stats);
+    template <typename Nonlinearity, int fixedIterations, int order, typename SampleType>
+    void processVoices(juce::dsp::AudioBlock<SampleType>& block, const juce::MidiBuffer& midi, int hostStart, int factor,
+                       const double* feedbackModulation);
+    template <int fixedIterations, int order, typename SampleType>
+    void processLadderOfOrder(juce::dsp::AudioBlock<SampleType>& block, const juce::MidiBuffer& midi, int hostStart, int factor,
+                              const double* cutoffModulation, const double* feedbackModulation);
+
+    static constexpr double maxTailSeconds = 30.0;
     juce::AudioProcessorValueTreeState audioTree;
 
+    static constexpr int maxOversamplingStages = 4; // 16x
+    static constexpr int maxChannels = 16;          // up to 7.1.4 or third-order ambisonics
+    static constexpr LadderResponse ladderResponse = static_cast<LadderResponse> (VCF_LADDER_RESPONSE);
+
 private:
-    double controlledK, K, controlledVt, Vt, controlledF0, f0;
-    double I0, C, Fs, gamma, eta, err, T;
-    double vin1, vc1, vc2, vc3, vc4, vc11, vc21, vc31, vc41, /*u1, u2, u3, u4, u5,*/ s1, s2, s3, s4, xc1, xc2, xc3, xc4;
-    double vc4Past;
-    double vin1Temp, vc1Temp, vc11Temp, vc2Temp, vc21Temp, vc3Temp, vc31Temp, vc4Temp, vc41Temp,
-        /*u1Temp, u2Temp, u3Temp, u4Temp, u5Temp, s1Temp, s2Temp, s3Temp, s4Temp,*/ xc1Temp, xc2Temp, xc3Temp, xc4Temp;
-    
-    float vin;
-    float vout, voutTemp;
-    float* voutP = &vout;
-    int upsamplingScale;
-
-    juce::dsp::ProcessorDuplicator< juce::dsp::IIR::Filter <float>, juce::dsp::IIR::Coefficients<float>> lowPassFilter;
+    /** One oversampling setting. Its half-band stages are the only filters around the solver,
+        with states of their own in each direction: on the way up they remove the images of
+        the input, on the way down whatever the ladder generated above the host's Nyquist.
+    */
+    template <typename SampleType>
+    struct Resampler
+    {
+        std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversampling;
+        int numStages = 0;
+    };
+
+    /** Everything processBlock keeps that depends on the sample type of the host's buffers.
+        Only the engine of the current processing precision is prepared; the other one stays empty.
+    */
+    template <typename SampleType>
+    struct Engine
+    {
+        // channels of one ladder group, a SIMD register of them in this precision
+        static constexpr int numLanes = ladderLanesOf<SampleType>;
+        using State = LadderState<numLanes, SampleType, ladderMaxOrder>;
+
+        // every factor/filter combination is built in prepareToPlay, so switching on the audio thread never allocates
+        std::array<std::unique_ptr<Resampler<SampleType>>, 2 * (maxOversamplingStages + 1)> resamplers;
+        Resampler<SampleType>* activeResampler = nullptr;
+
+        // one state per group of numLanes channels, each channel in its own lane, with room for any order
+        std::vector<State> ladderStates;
+
+        // one state per group of voices in the polyphonic mode, laid out by VoicePool
+        std::vector<State> voiceStates;
+
+        // the last output samples, read back so that a governed, lower oversampling factor
+        // has the latency of the selected one
+        juce::AudioBuffer<SampleType> latencyDelay;
+        int delaySamples = 0, delayPosition = 0;
+
+        // A new factor crossfades from the one before over a sub-block: the outgoing resampler
+        // runs that sub-block once more, in its own buffer and on copies of the ladder states.
+        juce::AudioBuffer<SampleType> outgoingBlock;
+        std::vector<State> outgoingLadderStates, outgoingVoiceStates;
+
+        // the last input samples, read back at the reported latency as the bypassed signal,
+        // and one sub-block of that while the bypass fades
+        juce::AudioBuffer<SampleType> dryDelay, dryBlock;
+        int dryPosition = 0;
+    };
+
+    template <typename SampleType>
+    Engine<SampleType>& getEngine() noexcept;
+
+    template <typename SampleType>
+    void prepareEngine(Engine<SampleType>& engine);
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midi, bool bypass);
+    template <typename SampleType>
+    bool updateIdleGroups(const juce::AudioBuffer<SampleType>& input);
+    template <typename SampleType>
+    void delayOutput(Engine<SampleType>& engine, const juce::dsp::AudioBlock<SampleType>& output, int delay);
+    template <typename SampleType>
+    void delayDry(Engine<SampleType>& engine, const juce::dsp::AudioBlock<SampleType>& input, const juce::dsp::AudioBlock<SampleType>& output, int delay);
+    template <typename SampleType>
+    void resetForBypass(Engine<SampleType>& engine);
+    template <typename SampleType>
+    void updateModulation(const juce::AudioBuffer<SampleType>& sidechain, int startSample, int numSamples, int factor,
+                          double startF0, double startK, double startVt, double endVt,
+                          const double*& cutoffModulation, const double*& feedbackModulation);
+    double advanceParameters(int numSamples);
+
+    static int getResamplerIndex (int numStages, bool linearPhase) noexcept { return numStages + (linearPhase ? maxOversamplingStages + 1 : 0); }
+    template <typename SampleType>
+    static int getResamplerLatency (const Engine<SampleType>& engine, int numStages, bool linearPhase)
+    {
+        return juce::roundToInt(engine.resamplers[(size_t) getResamplerIndex(numStages, linearPhase)]->oversampling->getLatencyInSamples());
+    }
+    void handleAsyncUpdate() override;
+    void handleVoiceMessage(const juce::MidiMessage& message, int position);
+    void publishTelemetry(juce::int64 startTicks, int numSamples, int oversamplingFactor);
+    double computeTailSeconds(double k, double cutoff, double vt, int order) const;
+
+    // written by parameterChanged from any thread, read once per block by processBlock
+    std::atomic<double> controlledK { 0.5 }, controlledVt { 0.026 }, controlledF0 { 1000.0 };
+
+    static constexpr double parameterRampSeconds = 0.02;
+
+    // The block is upsampled, solved and downsampled in sub-blocks of this many solver
+    // samples, 64 host samples at 4x, so the oversampled audio stays in the L1 cache
+    // between the three passes. The smoothed parameters are evaluated at the end of
+    // every sub-block and the solver constants ramp linearly in between.
+    static constexpr int subBlockSamples = 256;
+    LadderParameterRamp smoothedK, smoothedVt, smoothedOctave; // the cutoff in octaves, so it glides evenly in pitch
+    int parameterRampSamples = 0;
+
+    double K = 0.5, Vt = 0.026, f0 = 1000.0;
+    double I0 = 0.0, C = 0.01e-6, Fs = 44100.0, gamma = 0.0, eta = 1.836, err = 10e-4, T = 0.0;
+    double hostFs = 44100.0;
+
+    std::atomic<int> quality { VCF_DEFAULT_TANH_QUALITY };
+    std::atomic<int> oversamplingStages { VCF_DEFAULT_OVERSAMPLING };
+    std::atomic<bool> linearPhase { false };
+    std::atomic<int> predictor { VCF_DEFAULT_PREDICTOR };
+    std::atomic<bool> eco { false };
+    std::atomic<bool> fixedCost { false }; // every sample takes ladderFixedIterations Newton steps
+    std::atomic<int> ladderOrder { 4 };     // stages of the ladder, 2, 4, 6 or 8
+    int activeOrder = 4;                    // the order processBlock last ran, on the audio thread
+    std::atomic<bool> polyphonic { false }; // MIDI notes allocate key-tracked voices from VoicePool
+    bool activePolyphonic = false;          // the mode processBlock last ran, on the audio thread
+    int activeQuality = VCF_DEFAULT_TANH_QUALITY; // the tanh processBlock runs, after the governor
+
+    // Steps the quality down when blocks near their deadline. It only runs in real time:
+    // an offline render always gets the quality that was asked for.
+    std::atomic<bool> governorEnabled { true };
+    QualityGovernor governor;
+    bool governing = false;
+
+    // The host's bypass fades between the filtered signal and the input delayed by the
+    // reported latency. Once faded over, nothing but that delay runs, and the ladder,
+    // voices and filters are reset, so coming back always starts from rest.
+    static constexpr double bypassFadeSeconds = 0.02;
+    juce::SmoothedValue<double> bypassMix; // 0 = filtered, 1 = bypassed
+    std::atomic<double> cvCutoffDepth { 2.0 }, cvFeedbackDepth { 0.0 };
+
+    // per-sample solver constants driven by the sidechain CV, at the solver rate
+    std::vector<double> modulatedA, modulatedGain;
+    double lastCv[2] = {};
+
+    Engine<float> floatEngine;
+    Engine<double> doubleEngine;
+    VoicePool voices;
+
+    LadderCoefficients ladderCoefficients, targetCoefficients; // at the start and the end of the block
+    LadderCoefficientRamp coefficientRamp;
+    SolverStats solverStats;
+
+    // Silence detection: a group of channels goes idle once its input has been below
+    // silenceThreshold for longer than the resampling filters ring and its ladder
+    // state has decayed below stateThreshold. Idle groups skip the solver, and a
+    // block on which every group is idle skips the oversampling as well.
+    static constexpr float silenceThreshold = 1.0e-6f; // -120 dBFS
+    static constexpr double stateThreshold = 1.0e-7;
+    static constexpr int idleHoldSamples = 64;
+    std::vector<int> silentSamples;  // per channel, input samples below silenceThreshold in a row
+    std::vector<char> idleGroups;    // per ladder group
+    bool idle = false;
+
+    // Eco mode: a group whose estimated drive stays below LinearLadderSolver::maxDrive
+    // runs through the linear ladder. It switches back once the drive exceeds that,
+    // and only comes down again below ecoHysteresis times it. A block that switches
+    // runs both ladders and crossfades between them.
+    static constexpr double ecoHysteresis = 0.5;
+    std::vector<char> linearGroups;     // per ladder group
+    std::vector<double> outputPeaks;    // per ladder group, peak of the last solved block
+    std::vector<char> outgoingLinearGroups;  // both of them as they were before the outgoing resampler's last sub-block
+    std::vector<double> outgoingOutputPeaks;
+
+    // Stereo link: a group whose channels carry the same signal, within linkThreshold,
+    // and whose lanes hold the same state is solved on one lane and copied to the rest.
+    static constexpr float linkThreshold = 1.0e-6f; // -120 dBFS between the channels
+    std::atomic<bool> linkChannels { true };
+
+    // Channel groups run on the worker pool once there are several of them and the
+    // block at the solver rate is long enough to be worth waking the workers for.
+    static constexpr int minParallelSamples = 256;
+    std::unique_ptr<WorkerPool> workerPool;
+    int maxWorkers = -1;
+    std::vector<SolverStats> groupStats; // per ladder group, added to solverStats after each block
+
+    std::atomic<double> tailSeconds { 0.0 };
+    SnapshotPublisher<SolverStats> telemetry;
+    std::unique_ptr<TelemetryLog> telemetryLog;
 
 
     //==============================================================================
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Trades fidelity for time when processBlock gets close to its deadline,
+    and gives it back once the load has come down again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/**
+    The quality level processBlock runs at, driven by the load of the blocks
+    before it: the time a block took over the audio time it covers.
+
+    Each level down keeps the ones above it and adds the next saving:
+
+        looseTolerance     the Newton iteration stops at looserTolerance times the step size
+        fixedCost          every sample takes ladderFixedIterations Newton steps, however hard it is
+        fastTanh           the interpolated tanh table, whatever the quality setting
+        lowerOversampling  one oversampling stage fewer, with the latency kept the same and a crossfade to it
+
+    A level the settings already imply, e.g. fastTanh with the table selected,
+    changes nothing, and the next overloaded blocks simply move on past it.
+
+    One block that overran, or overloadBlocks blocks in a row above
+    stepDownLoad, go one level down. After every step the governor waits
+    settleSeconds before going further down, so the next decision sees the
+    load of the new level. It only goes back up after recoverSeconds without
+    a block above stepUpLoad; that is well below half of stepDownLoad, since
+    a level up can cost about twice as much.
+*/
+class QualityGovernor
+{
+public:
+    enum Level
+    {
+        full = 0,
+        looseTolerance,
+        fixedCost,
+        fastTanh,
+        lowerOversampling,
+        lowest = lowerOversampling
+    };
+
+    static constexpr double stepDownLoad = 0.85;
+    static constexpr double stepUpLoad = 0.35;
+    static constexpr int overloadBlocks = 2;
+    static constexpr double settleSeconds = 0.1;
+    static constexpr double recoverSeconds = 2.0;
+    static constexpr double looserTolerance = 10.0;
+
+    /** Goes back to full quality, e.g. when the governor is switched off. */
+    void reset() noexcept
+    {
+        level = full;
+        overloadedBlocks = 0;
+        secondsSinceStep = secondsUnderLoad = 0.0;
+    }
+
+    Level getLevel() const noexcept { return level; }
+
+    /** Takes the load of a block that covered the given audio time, and steps the level if it has to.
+        Returns true if the level changed.
+    */
+    bool update (double load, double seconds) noexcept
+    {
+        secondsSinceStep += seconds;
+        overloadedBlocks = load > stepDownLoad ? overloadedBlocks + 1 : 0;
+        secondsUnderLoad = load < stepUpLoad ? secondsUnderLoad + seconds : 0.0;
+
+        if (level < lowest && secondsSinceStep >= settleSeconds && (load > 1.0 || overloadedBlocks >= overloadBlocks))
+            return step (static_cast<Level> (level + 1));
+
+        if (level > full && secondsUnderLoad >= recoverSeconds)
+            return step (static_cast<Level> (level - 1));
+
+        return false;
+    }
+
+private:
+    bool step (Level newLevel) noexcept
+    {
+        level = newLevel;
+        overloadedBlocks = 0;
+        secondsSinceStep = secondsUnderLoad = 0.0;
+        return true;
+    }
+
+    Level level = full;
+    int overloadedBlocks = 0;
+    double secondsSinceStep = 0.0, secondsUnderLoad = 0.0;
+};
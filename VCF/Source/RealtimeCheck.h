@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    RealtimeCheck.h
+
+    Test-mode hook that catches heap allocations and mutex locks made while
+    the audio thread is inside processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// Set to 1 to mark the audio callback and fail on any allocation or lock made
+// from inside it. The marking is free, but catching the violations needs the
+// global allocation and pthread hooks from Tools/RenderCLI/RealtimeCheckHooks.cpp
+// linked into the executable.
+#ifndef VCF_REALTIME_CHECKS
+ #define VCF_REALTIME_CHECKS 0
+#endif
+
+#if VCF_REALTIME_CHECKS
+ #include <cstdio>
+ #include <cstdlib>
+#endif
+
+//==============================================================================
+namespace RealtimeCheck
+{
+   #if VCF_REALTIME_CHECKS
+    /** True while the calling thread is inside a ScopedAudioCallback. */
+    inline thread_local bool inAudioCallback = false;
+
+    /** Reports a real-time safety violation and aborts, so that a test run
+        fails on the first offending call rather than on a later glitch.
+    */
+    [[noreturn]] inline void fail (const char* what) noexcept
+    {
+        inAudioCallback = false; // so that reporting doesn't trip the hooks again
+        std::fprintf (stderr, "Real-time violation: %s inside processBlock\n", what);
+        std::abort();
+    }
+
+    /** Called by the hooks, fails if the current thread is in the audio callback. */
+    inline void check (const char* what) noexcept
+    {
+        if (inAudioCallback)
+            fail (what);
+    }
+
+    /** Marks the current thread as running the audio callback for its lifetime. */
+    struct ScopedAudioCallback
+    {
+        ScopedAudioCallback() noexcept   : wasInCallback (inAudioCallback)  { inAudioCallback = true; }
+        ~ScopedAudioCallback()                                              { inAudioCallback = wasInCallback; }
+
+        const bool wasInCallback;
+    };
+   #else
+    struct ScopedAudioCallback
+    {
+        ScopedAudioCallback() noexcept {}
+    };
+   #endif
+}
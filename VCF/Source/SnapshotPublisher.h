@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    SnapshotPublisher.h
+
+    Hands copies of a small struct from the audio thread to any number of
+    reader threads without locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//==============================================================================
+/**
+    A sequence lock over a trivially copyable value.
+
+    publish() is wait-free: it bumps the sequence number, stores the value as
+    relaxed atomic words and bumps the sequence number again, so the audio
+    thread never waits for a reader. read() retries until it sees the same
+    even sequence number before and after copying the words, which only
+    happens when it raced a publish().
+
+    Only one thread may publish; any number of threads may read.
+*/
+template <typename Type>
+class SnapshotPublisher
+{
+public:
+    static_assert (std::is_trivially_copyable<Type>::value, "the snapshot is copied word by word");
+
+    /** Makes value the current snapshot. Only call this from the publishing thread. */
+    void publish (const Type& value) noexcept
+    {
+        std::uint64_t source[numWords] = {};
+        std::memcpy (source, &value, sizeof (Type));
+
+        auto sequence = sequenceNumber.load (std::memory_order_relaxed);
+        sequenceNumber.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (int i = 0; i < numWords; ++i)
+            words[i].store (source[i], std::memory_order_relaxed);
+
+        sequenceNumber.store (sequence + 2, std::memory_order_release);
+    }
+
+    /** Returns the most recently published snapshot, or all zeros before the first publish(). */
+    Type read() const noexcept
+    {
+        std::uint64_t destination[numWords];
+
+        for (;;)
+        {
+            auto before = sequenceNumber.load (std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+                continue;
+
+            for (int i = 0; i < numWords; ++i)
+                destination[i] = words[i].load (std::memory_order_relaxed);
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (sequenceNumber.load (std::memory_order_relaxed) == before)
+                break;
+        }
+
+        Type value;
+        std::memcpy (&value, destination, sizeof (Type));
+        return value;
+    }
+
+private:
+    static constexpr int numWords = (int) ((sizeof (Type) + sizeof (std::uint64_t) - 1) / sizeof (std::uint64_t));
+
+    std::atomic<std::uint64_t> sequenceNumber { 0 };
+    std::atomic<std::uint64_t> words[numWords] = {};
+};
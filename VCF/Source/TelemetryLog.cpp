@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    TelemetryLog.cpp
+
+  ==============================================================================
+*/
+
+#include "TelemetryLog.h"
+
+//==============================================================================
+TelemetryLog::TelemetryLog (VCFAudioProcessor& processorToLog, const juce::File& file, int intervalMilliseconds)
+    : juce::Thread ("VCF telemetry log"), processor (processorToLog), interval (intervalMilliseconds)
+{
+    auto isNewFile = ! file.existsAsFile() || file.getSize() == 0;
+    stream = file.createOutputStream();
+
+    if (stream == nullptr || stream->failedToOpen())
+    {
+        stream.reset();
+        return;
+    }
+
+    if (isNewFile)
+    {
+        // the iteration histogram takes one column per count, as the fraction of samples that took it
+        juce::String header ("time,sample_rate,block_size,oversampling,quality,blocks,"
+                             "iterations_per_sample,max_iterations,non_converged,tanh_calls_per_second,"
+                             "load,max_load,overruns,idle_blocks,linear_fraction,voices,governor_level,linked_fraction,bypassed_blocks");
+
+        for (int i = 0; i <= ladderMaxIterations; ++i)
+            header << ",iterations_" << i << "_fraction";
+
+        stream->writeText (header + "\n", false, false, nullptr);
+    }
+
+    startThread();
+}
+
+TelemetryLog::~TelemetryLog()
+{
+    stopThread (interval + 1000);
+}
+
+void TelemetryLog::run()
+{
+    auto previous = processor.getTelemetry();
+
+    while (! threadShouldExit())
+    {
+        wait (interval);
+
+        auto current = processor.getTelemetry();
+
+        // skip idle intervals, and start over when the counters were reset
+        if (current.blocks < previous.blocks)
+            previous = {};
+
+        if (current.blocks > previous.blocks)
+            writeRow (previous, current);
+
+        previous = current;
+    }
+}
+
+void TelemetryLog::writeRow (const VCFAudioProcessor::SolverStats& previous, const VCFAudioProcessor::SolverStats& current)
+{
+    auto samples = (double) juce::jmax ((juce::uint64) 1, current.samples - previous.samples);
+    auto deadline = current.deadlineSeconds - previous.deadlineSeconds;
+    auto busy = current.busySeconds - previous.busySeconds;
+
+    juce::StringArray row;
+    row.add (juce::Time::getCurrentTime().toISO8601 (true));
+    row.add (juce::String (current.sampleRate));
+    row.add (juce::String (current.blockSize));
+    row.add (juce::String (current.oversamplingFactor));
+    row.add (juce::String (current.quality));
+    row.add (juce::String (current.blocks - previous.blocks));
+    row.add (juce::String ((double) (current.iterations - previous.iterations) / samples, 4));
+    row.add (juce::String (VCFAudioProcessor::SolverStats::getMaxIterations (previous, current)));
+    row.add (juce::String (current.nonConverged - previous.nonConverged));
+    row.add (juce::String (deadline > 0.0 ? (double) (current.tanhCalls - previous.tanhCalls) / deadline : 0.0, 0));
+    row.add (juce::String (deadline > 0.0 ? busy / deadline : 0.0, 4));
+    row.add (juce::String (current.maxLoad, 4));
+    row.add (juce::String (current.overruns - previous.overruns));
+    row.add (juce::String (current.idleBlocks - previous.idleBlocks));
+    row.add (juce::String ((double) (current.linearSamples - previous.linearSamples) / samples, 4));
+    row.add (juce::String (current.voices));
+    row.add (juce::String (current.governorLevel));
+    row.add (juce::String ((double) (current.linkedSamples - previous.linkedSamples) / samples, 4));
+    row.add (juce::String (current.bypassedBlocks - previous.bypassedBlocks));
+
+    for (int i = 0; i <= ladderMaxIterations; ++i)
+        row.add (juce::String ((double) (current.iterationHistogram[i] - previous.iterationHistogram[i]) / samples, 4));
+
+    stream->writeText (row.joinIntoString (",") + "\n", false, false, nullptr);
+    stream->flush();
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    TelemetryLog.h
+
+    Background writer that appends the processor's solver telemetry to a CSV
+    file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Reads VCFAudioProcessor::getTelemetry() on its own thread and appends one
+    CSV row per interval, with the counters turned into rates over that
+    interval. Nothing here touches the audio thread, which only publishes the
+    snapshot.
+*/
+class TelemetryLog  : private juce::Thread
+{
+public:
+    TelemetryLog (VCFAudioProcessor& processorToLog, const juce::File& file, int intervalMilliseconds = 1000);
+    ~TelemetryLog() override;
+
+    /** False if the file could not be opened, in which case nothing is logged. */
+    bool isOpen() const noexcept     { return stream != nullptr; }
+
+private:
+    void run() override;
+    void writeRow (const VCFAudioProcessor::SolverStats& previous, const VCFAudioProcessor::SolverStats& current);
+
+    VCFAudioProcessor& processor;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    const int interval;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryLog)
+};
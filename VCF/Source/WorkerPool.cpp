@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    WorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+#include "RealtimeCheck.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#else
+ #include <thread>
+#endif
+
+//==============================================================================
+/** Counting semaphore of the platform; unlike juce::WaitableEvent, posting it takes no mutex. */
+class WorkerPool::Semaphore
+{
+public:
+   #if JUCE_WINDOWS
+    Semaphore()  : handle (CreateSemaphoreW (nullptr, 0, 0x7fffffff, nullptr)) {}
+    ~Semaphore() { CloseHandle (handle); }
+
+    void post() noexcept { ReleaseSemaphore (handle, 1, nullptr); }
+    void wait() noexcept { WaitForSingleObject (handle, INFINITE); }
+
+   private:
+    HANDLE handle;
+   #elif JUCE_MAC || JUCE_IOS
+    Semaphore()  : handle (dispatch_semaphore_create (0)) {}
+    ~Semaphore() { dispatch_release (handle); }
+
+    void post() noexcept { dispatch_semaphore_signal (handle); }
+    void wait() noexcept { dispatch_semaphore_wait (handle, DISPATCH_TIME_FOREVER); }
+
+   private:
+    dispatch_semaphore_t handle;
+   #else
+    Semaphore()  { sem_init (&handle, 0, 0); }
+    ~Semaphore() { sem_destroy (&handle); }
+
+    void post() noexcept { sem_post (&handle); }
+    void wait() noexcept { while (sem_wait (&handle) != 0 && errno == EINTR) {} }
+
+   private:
+    sem_t handle;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (Semaphore)
+};
+
+//==============================================================================
+class WorkerPool::Worker  : public juce::Thread
+{
+public:
+    Worker (WorkerPool& ownerPool, int index)
+        : juce::Thread ("VCF worker " + juce::String (index)), pool (ownerPool)
+    {
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        semaphore.post();
+        stopThread (1000);
+    }
+
+    /** Lets a sleeping worker know there is a new job. Real-time safe. */
+    void wake() noexcept
+    {
+        if (sleeping.exchange (false))
+            semaphore.post();
+    }
+
+    void run() override
+    {
+        auto spinTicks = juce::Time::secondsToHighResolutionTicks (spinSeconds);
+        auto seen = getGeneration (pool.job.load (std::memory_order_acquire));
+
+        while (! threadShouldExit())
+        {
+            auto spinEnd = juce::Time::getHighResolutionTicks() + spinTicks;
+
+            while (getGeneration (pool.job.load (std::memory_order_acquire)) == seen)
+            {
+                if (threadShouldExit())
+                    return;
+
+                if (juce::Time::getHighResolutionTicks() < spinEnd)
+                {
+                    pause();
+                    continue;
+                }
+
+                // If a job came in after all, either this takes the flag back and carries
+                // on, or wake() already took it and the post it makes has to be consumed.
+                // The fence pairs with the one in WorkerPool::run(): a store then a load of
+                // another variable on each side, which only a full fence keeps in order, so
+                // either this sees the new job or run() sees the flag.
+                sleeping.store (true);
+                std::atomic_thread_fence (std::memory_order_seq_cst);
+
+                if (getGeneration (pool.job.load (std::memory_order_acquire)) != seen && sleeping.exchange (false))
+                    continue;
+
+                semaphore.wait();
+                spinEnd = juce::Time::getHighResolutionTicks() + spinTicks;
+            }
+
+            seen = getGeneration (pool.job.load (std::memory_order_acquire));
+
+            RealtimeCheck::ScopedAudioCallback realtimeCheck;
+            juce::ScopedNoDenormals noDenormals;
+            pool.runTasks (seen);
+        }
+    }
+
+private:
+    WorkerPool& pool;
+    Semaphore semaphore;
+    std::atomic<bool> sleeping { false };
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+WorkerPool::WorkerPool (int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add (new Worker (*this, i))->startThread (juce::Thread::realtimeAudioPriority);
+}
+
+WorkerPool::~WorkerPool()
+{
+    workers.clear();
+}
+
+void WorkerPool::run (int numTasks, void (*task) (void*, int), void* context) noexcept
+{
+    jassert (numTasks <= maxTasks);
+    numTasks = juce::jmin (numTasks, maxTasks);
+
+    if (numTasks <= 0)
+        return;
+
+    // the task is in place before the job that points the workers at it
+    taskFunction = task;
+    taskContext = context;
+    pendingTasks.store (numTasks, std::memory_order_relaxed);
+
+    auto generation = getGeneration (job.load (std::memory_order_relaxed)) + 1;
+    job.store (((std::uint64_t) generation << 32) | ((std::uint64_t) numTasks << 16), std::memory_order_release);
+
+    // keeps the store of the job ahead of the loads of the sleeping flags, see Worker::run()
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+
+    for (auto* worker : workers)
+        worker->wake();
+
+    runTasks (generation);
+
+    while (pendingTasks.load (std::memory_order_acquire) > 0)
+        pause();
+}
+
+void WorkerPool::runTasks (std::uint32_t generation) noexcept
+{
+    auto current = job.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        auto numTasks = (int) ((current >> 16) & 0xffff);
+        auto next = (int) (current & 0xffff);
+
+        if (getGeneration (current) != generation || next >= numTasks)
+            return;
+
+        if (! job.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        taskFunction (taskContext, next);
+        pendingTasks.fetch_sub (1, std::memory_order_release);
+    }
+}
+
+void WorkerPool::pause() noexcept
+{
+   #if JUCE_INTEL
+    _mm_pause();
+   #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+    __asm__ __volatile__ ("yield");
+   #else
+    std::this_thread::yield();
+   #endif
+}
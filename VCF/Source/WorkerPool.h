@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+
+    Fixed set of pre-spawned threads that processBlock hands independent
+    tasks to, without locks or allocations.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdint>
+
+//==============================================================================
+/**
+    Runs the tasks of a job in parallel on numWorkers pre-spawned threads and
+    the calling thread.
+
+    run() publishes a job with one atomic store and then takes tasks itself,
+    so the job finishes even if no worker gets to it in time. Claiming a task
+    is a compare-and-swap on a single word that holds the job's generation,
+    its task count and the next task, so a worker that wakes up late cannot
+    take a task of a later job.
+
+    After a job a worker spins for spinSeconds, since the next block's job
+    usually follows shortly, and then sleeps on a semaphore. run() only posts
+    to workers that went to sleep; posting never takes a lock, so run() is
+    real-time safe. It waits for the last task by spinning.
+
+    Tasks run on the workers with denormals flushed, and count as part of the
+    audio callback for RealtimeCheck.
+*/
+class WorkerPool
+{
+public:
+    explicit WorkerPool (int numWorkers);
+    ~WorkerPool();
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    /** Calls function (task) for every task from 0 to numTasks - 1, spread over the
+        workers and the calling thread, and returns once all of them have finished.
+    */
+    template <typename Function>
+    void run (int numTasks, Function& function) noexcept
+    {
+        run (numTasks, [] (void* context, int task) { (*static_cast<Function*> (context)) (task); }, &function);
+    }
+
+    void run (int numTasks, void (*task) (void*, int), void* context) noexcept;
+
+    static constexpr double spinSeconds = 0.0002;
+    static constexpr int maxTasks = 0xffff;
+
+private:
+    class Semaphore;
+    class Worker;
+
+    /** Takes tasks of the job with this generation until none are left. */
+    void runTasks (std::uint32_t generation) noexcept;
+
+    static std::uint32_t getGeneration (std::uint64_t word) noexcept { return (std::uint32_t) (word >> 32); }
+    static void pause() noexcept;
+
+    std::atomic<std::uint64_t> job { 0 }; // generation << 32 | number of tasks << 16 | next task
+    std::atomic<int> pendingTasks { 0 };
+    void (*taskFunction) (void*, int) = nullptr;
+    void* taskContext = nullptr;
+
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
@@ -0,0 +1,900 @@
+/*
+  ==============================================================================
+
+    CoreTests.cpp
+
+    Checks the numbers the solver, its tanh kernels, the core's oversampler
+    and the C API promise, without JUCE. Run through CTest; the exit code is
+    the number of failed checks.
+
+  ==============================================================================
+*/
+
+#include "LadderSolver.h"
+#include "HalfBandOversampler.h"
+#include "LadderEngine.h"
+#include "VCFCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check (bool condition, const char* what, double value = 0.0)
+    {
+        if (! condition)
+        {
+            std::printf ("FAILED: %s (%g)\n", what, value);
+            ++failures;
+        }
+    }
+
+    constexpr double pi = 3.14159265358979323846;
+
+    /** A few cycles of a hard-driven sine, with a level step halfway through. */
+    std::vector<double> makeDrive (double rate, int numSamples)
+    {
+        std::vector<double> drive ((size_t) numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+            drive[(size_t) i] = (i < numSamples / 2 ? 1.0 : 0.25) * std::sin (2.0 * pi * 220.0 * i / rate);
+
+        return drive;
+    }
+
+    //==============================================================================
+    /** Newton at the plugin's tolerance lands on the solution of a tightly converged reference. */
+    void testNewtonAgainstReference()
+    {
+        const auto rate = 4.0 * 48000.0;
+        auto drive = makeDrive (rate, 20000);
+
+        for (auto k : { 0.5, 3.5 })
+        {
+            LadderCoefficients coefficients, reference;
+            LadderCircuit::setCoefficients (coefficients, 2000.0, k, LadderCircuit::thermalVoltage, rate);
+            LadderCircuit::setCoefficients (reference, 2000.0, k, LadderCircuit::thermalVoltage, rate, 1.0e-12);
+            coefficients.setPredictor (LadderPredictor::quadratic);
+            reference.setPredictor (LadderPredictor::previous);
+
+            LadderState<1, double> state, referenceState;
+            state.reset();
+            referenceState.reset();
+
+            auto maxDifference = 0.0;
+            auto maxIterations = 0;
+            auto allConverged = true;
+
+            for (auto vin : drive)
+            {
+                double vout, referenceOut;
+                bool converged, referenceConverged;
+
+                auto iterations = LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+                LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (reference, referenceState, &vin, &referenceOut, referenceConverged);
+
+                maxDifference = std::max (maxDifference, std::abs (vout - referenceOut));
+                maxIterations = std::max (maxIterations, iterations);
+                allConverged = allConverged && converged;
+            }
+
+            check (maxDifference < 1.0e-7, "Newton output within 1e-7 of the tight reference", maxDifference);
+            check (maxIterations <= ladderMaxIterations, "Newton stays within ladderMaxIterations", maxIterations);
+            check (allConverged, "Newton converges on every sample", k);
+        }
+    }
+
+    /** The hand-unrolled four-stage Newton solve the generic one replaced, on a single lane with std::tanh. */
+    struct FourStageReference
+    {
+        double solve (const LadderCoefficients& c, double vin) noexcept
+        {
+            double v[4];
+
+            for (int i = 0; i < 4; ++i)
+                v[i] = c.predict[0] * vc[i] + c.predict[1] * vcPast[0][i] + c.predict[2] * vcPast[1][i];
+
+            for (int iteration = 0; iteration < ladderMaxIterations; ++iteration)
+            {
+                const auto u0 = std::tanh ((vin - c.outputGain * v[3]) * c.inputScale);
+                const auto u1 = std::tanh ((v[1] - v[0]) * c.stageScale);
+                const auto u2 = std::tanh ((v[2] - v[1]) * c.stageScale);
+                const auto u3 = std::tanh ((v[3] - v[2]) * c.stageScale);
+                const auto u4 = std::tanh (v[3] * c.lastStageScale);
+
+                auto r1 = v[0] - c.a * (u0 + u1) - s[0];
+                auto r2 = v[1] - c.a * (u2 - u1) - s[1];
+                auto r3 = v[2] - c.a * (u3 - u2) - s[2];
+                auto r4 = v[3] + c.a * (u4 + u3) - s[3];
+
+                const auto d0 = c.a * (1.0 - u0 * u0) * c.inputScale;
+                const auto d1 = c.a * (1.0 - u1 * u1) * c.stageScale;
+                const auto d2 = c.a * (1.0 - u2 * u2) * c.stageScale;
+                const auto d3 = c.a * (1.0 - u3 * u3) * c.stageScale;
+                const auto d4 = c.a * (1.0 - u4 * u4) * c.lastStageScale;
+
+                auto b1 = 1.0 + d1, b2 = 1.0 + d1 + d2, b3 = 1.0 + d2 + d3, b4 = 1.0 + d3 + d4;
+                const auto e1 = d0 * c.outputGain;
+
+                auto m = -d1 / b1;
+                b2 -= m * -d1;
+                auto e2 = -m * e1;
+                r2 -= m * r1;
+
+                m = -d2 / b2;
+                b3 -= m * -d2;
+                auto c3 = -d3 - m * e2;
+                r3 -= m * r2;
+
+                m = -d3 / b3;
+                b4 -= m * c3;
+                r4 -= m * r3;
+
+                const auto dv4 = r4 / b4;
+                const auto dv3 = (r3 - c3 * dv4) / b3;
+                const auto dv2 = (r2 + d2 * dv3 - e2 * dv4) / b2;
+                const auto dv1 = (r1 + d1 * dv2 - e1 * dv4) / b1;
+
+                v[0] -= dv1;
+                v[1] -= dv2;
+                v[2] -= dv3;
+                v[3] -= dv4;
+
+                auto scale = std::abs (v[0]) + std::abs (v[1]) + std::abs (v[2]) + std::abs (v[3]);
+                auto step = std::abs (dv1) + std::abs (dv2) + std::abs (dv3) + std::abs (dv4);
+
+                if (step <= scale * c.err + 1.0e-9)
+                    break;
+            }
+
+            for (int i = 0; i < 4; ++i)
+            {
+                s[i] = 2.0 * v[i] - s[i];
+                vcPast[1][i] = vcPast[0][i];
+                vcPast[0][i] = vc[i];
+                vc[i] = v[i];
+            }
+
+            return c.outputGain * v[3];
+        }
+
+        double vc[4] = {}, vcPast[2][4] = {}, s[4] = {};
+    };
+
+    /** The generic solver of order four follows the hand-unrolled one it replaced, to within rounding. */
+    void testOrderFourAgainstUnrolled()
+    {
+        const auto rate = 4.0 * 48000.0;
+        auto drive = makeDrive (rate, 20000);
+
+        for (auto k : { 0.5, 3.5 })
+        {
+            LadderCoefficients coefficients;
+            LadderCircuit::setCoefficients (coefficients, 2000.0, k, LadderCircuit::thermalVoltage, rate);
+            coefficients.setPredictor (LadderPredictor::quadratic);
+
+            LadderState<1, double> state;
+            state.reset();
+            FourStageReference reference;
+
+            auto maxDifference = 0.0, peak = 0.0;
+
+            for (auto vin : drive)
+            {
+                double vout;
+                bool converged;
+
+                LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+                auto referenceOut = reference.solve (coefficients, vin);
+
+                maxDifference = std::max (maxDifference, std::abs (vout - referenceOut));
+                peak = std::max (peak, std::abs (referenceOut));
+            }
+
+            // the elimination orders a few operations differently, and a compiler may fuse others, which moves the last bits
+            check (maxDifference <= 1.0e-13 * peak, "order four within rounding of the unrolled solver", maxDifference / peak);
+        }
+    }
+
+    /** Each lane is its own channel: a lane solves exactly what a single-lane solver does with its input. */
+    void testLanesAreIndependent()
+    {
+        const auto rate = 2.0 * 48000.0;
+        auto drive = makeDrive (rate, 4000);
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 1000.0, 2.0, LadderCircuit::thermalVoltage, rate);
+
+        LadderState<ladderLanesOf<double>, double> lanes;
+        LadderState<1, double> single;
+        lanes.reset();
+        single.reset();
+
+        auto maxDifference = 0.0;
+
+        for (size_t i = 0; i < drive.size(); ++i)
+        {
+            double vin[ladderLanesOf<double>], vout[ladderLanesOf<double>], singleOut;
+            bool converged;
+
+            // lane 0 carries the drive, the others silence or something unrelated
+            for (int lane = 0; lane < ladderLanesOf<double>; ++lane)
+                vin[lane] = lane == 0 ? drive[i] : (lane % 2 == 0 ? 0.0 : -0.7 * drive[drive.size() - 1 - i]);
+
+            LadderSolver<Nonlinearities::ExactTanh, ladderLanesOf<double>>::processSample (coefficients, lanes, vin, vout, converged);
+            LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (coefficients, single, vin, &singleOut, converged);
+
+            maxDifference = std::max (maxDifference, std::abs (vout[0] - singleOut));
+        }
+
+        check (maxDifference < 1.0e-9, "a lane matches the single-lane solve of its own input", maxDifference);
+    }
+
+    /** Linked channels: with the same input in every lane, solving lane 0 alone and copying it out, as the
+        plugin does for a linked group, gives exactly what solving every lane does, unless the compiler
+        fuses multiply-adds, which it may do differently in the register and the single-lane code.
+    */
+    void testLinkedLanesMatch()
+    {
+        constexpr int numLanes = ladderLanesOf<double>;
+        const auto rate = 2.0 * 48000.0;
+        auto drive = makeDrive (rate, 4000);
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 1000.0, 3.0, LadderCircuit::thermalVoltage, rate);
+        coefficients.setPredictor (LadderPredictor::quadratic);
+
+        LadderState<numLanes, double, ladderMaxOrder> lanes, linked;
+        lanes.reset();
+        linked.reset();
+
+        auto maxDifference = 0.0, peak = 0.0;
+
+        for (size_t start = 0; start < drive.size(); start += 256)
+        {
+            LadderState<1, double, ladderMaxOrder> single;
+            single.copyLane (0, linked, 0);
+
+            for (auto i = start; i < std::min (drive.size(), start + 256); ++i)
+            {
+                double vin[numLanes], vout[numLanes], singleOut;
+                bool converged;
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    vin[lane] = drive[i];
+
+                LadderSolver<Nonlinearities::PadeTanh, numLanes>::processSample (coefficients, lanes, vin, vout, converged);
+                LadderSolver<Nonlinearities::PadeTanh, 1>::processSample (coefficients, single, vin, &singleOut, converged);
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    maxDifference = std::max (maxDifference, std::abs (vout[lane] - singleOut));
+
+                peak = std::max (peak, std::abs (singleOut));
+            }
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                linked.copyLane (lane, single, 0);
+        }
+
+       #if defined (__FMA__) || defined (__ARM_FEATURE_FMA)
+        const auto tolerance = 1.0e-13 * peak;
+       #else
+        const auto tolerance = 0.0;
+       #endif
+
+        check (maxDifference <= tolerance, "a linked group solved on one lane matches solving every lane", maxDifference);
+        check (linked.lanesMatch (numLanes, 0.0), "the linked state stays equal to itself across lanes", 0.0);
+    }
+
+    /** The antialiased tanh cuts the aliases a hard-driven ladder folds back at the host rate. */
+    void testAntialiasingReducesAliases()
+    {
+        const auto rate = 48000.0;
+        const int numSamples = 4800, settle = 9600, cycles = 487; // 4870 Hz, whose harmonics fold between its own bins
+
+        auto getAliasRatio = [&] (auto solve)
+        {
+            LadderState<1, double> state;
+            state.reset();
+            std::vector<double> output ((size_t) numSamples);
+
+            for (int n = 0; n < settle + numSamples; ++n)
+            {
+                auto vout = solve (state, std::sin (2.0 * pi * cycles * n / numSamples));
+
+                if (n >= settle)
+                    output[(size_t) (n - settle)] = vout;
+            }
+
+            // power in the bins of the harmonics below Nyquist against the power everywhere else
+            auto harmonics = 0.0, aliases = 0.0;
+
+            for (int bin = 1; bin < numSamples / 2; ++bin)
+            {
+                std::complex<double> sum;
+
+                for (int n = 0; n < numSamples; ++n)
+                    sum += output[(size_t) n] * std::polar (1.0, -2.0 * pi * bin * n / numSamples);
+
+                (bin % cycles == 0 ? harmonics : aliases) += std::norm (sum);
+            }
+
+            return aliases / harmonics;
+        };
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 2000.0, 0.5, LadderCircuit::thermalVoltage, rate);
+        coefficients.setPredictor (LadderPredictor::quadratic);
+
+        auto exact = getAliasRatio ([&] (LadderState<1, double>& state, double vin)
+        {
+            double vout;
+            bool converged;
+            LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+            return vout;
+        });
+
+        auto antialiased = getAliasRatio ([&] (LadderState<1, double>& state, double vin)
+        {
+            double vout;
+            bool converged;
+            LadderSolver<Nonlinearities::AntialiasedTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+            return vout;
+        });
+
+        // measured 26 dB
+        check (exact > 16.0 * antialiased, "the antialiased tanh takes the aliases down by more than 12 dB", 10.0 * std::log10 (exact / antialiased));
+    }
+
+    /** Any policy leaves the arguments of its solution in the state, so switching to the antialiased one starts on the right segment. */
+    void testArgumentsKeptForAntialiasing()
+    {
+        const auto rate = 2.0 * 48000.0;
+        auto drive = makeDrive (rate, 2000);
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 1500.0, 3.0, LadderCircuit::thermalVoltage, rate);
+
+        LadderState<1, double> state;
+        state.reset();
+
+        double vout;
+        bool converged;
+
+        for (auto vin : drive)
+            LadderSolver<Nonlinearities::PadeTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+
+        auto expected = (drive.back() - coefficients.outputGain * state.vc[3][0]) * coefficients.inputScale;
+        check (std::abs (state.argumentsPast[0][0] - expected) < 1.0e-12, "the input tanh argument is kept", state.argumentsPast[0][0]);
+
+        expected = (state.vc[2][0] - state.vc[1][0]) * coefficients.stageScale;
+        check (std::abs (state.argumentsPast[2][0] - expected) < 1.0e-12, "a stage tanh argument is kept", state.argumentsPast[2][0]);
+    }
+
+    /** Below maxDrive the linear ladder stays within maxLinearisationError of the nonlinear one, on a resonant ladder driven near its cutoff. */
+    void testLinearBelowMaxDrive()
+    {
+        const auto rate = 4.0 * 48000.0;
+        const auto blockSamples = 256, numBlocks = 400;
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 2000.0, 1.0, LadderCircuit::thermalVoltage, rate);
+        coefficients.setPredictor (LadderPredictor::quadratic);
+
+        LadderState<1, double> state, linearState;
+        state.reset();
+        linearState.reset();
+
+        auto outputPeak = 0.0, maxDrive = 0.0, maxDifference = 0.0, peak = 0.0;
+        auto n = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            auto drive = LinearLadderSolver<1>::estimateDrive (coefficients, 1.0e-3, outputPeak, state.getPeak());
+            outputPeak = 0.0;
+
+            for (int i = 0; i < blockSamples; ++i, ++n)
+            {
+                auto vin = 1.0e-3 * std::sin (2.0 * pi * 3000.0 * n / rate);
+                double vout, linearOut;
+                bool converged;
+
+                LadderSolver<Nonlinearities::ExactTanh, 1>::processSample (coefficients, state, &vin, &vout, converged);
+                LinearLadderSolver<1>::processSample (coefficients, linearState, &vin, &linearOut);
+
+                outputPeak = std::max (outputPeak, std::abs (vout));
+                maxDifference = std::max (maxDifference, std::abs (vout - linearOut));
+            }
+
+            maxDrive = std::max (maxDrive, drive);
+            peak = std::max (peak, outputPeak);
+        }
+
+        check (maxDrive < LinearLadderSolver<1>::maxDrive, "the test signal stays below maxDrive", maxDrive);
+        check (maxDifference < LinearLadderSolver<1>::maxLinearisationError * peak, "the linear ladder within maxLinearisationError below maxDrive", maxDifference / peak);
+    }
+
+    //==============================================================================
+    /** The linearised stage voltages of a ladder of the given order over eta e, times D (p), as LadderTaps derives them; returns D (p). */
+    std::complex<double> getLadderStages (int order, std::complex<double> p, std::complex<double> (&stage)[ladderMaxOrder])
+    {
+        stage[order - 1] = 1.0;
+        stage[order - 2] = p + 4.0 / 3.0;
+
+        for (int i = order - 2; i > 0; --i)
+            stage[i - 1] = (p + 2.0) * stage[i] - (i + 1 < order ? stage[i + 1] : 0.0);
+
+        return (p + 1.0) * stage[0] - stage[1];
+    }
+
+    /** The numerator of a response over D (p) at p, with the input pair's e at unit level. */
+    std::complex<double> getLadderNumerator (int order, LadderResponse response, std::complex<double> p, double eta, double outputGain)
+    {
+        std::complex<double> stage[ladderMaxOrder];
+        auto denominator = getLadderStages (order, p, stage);
+
+        if (response == LadderResponse::lowpass)
+            return outputGain * eta;
+
+        std::complex<double> mix = response == LadderResponse::highpass ? denominator : 0.0;
+
+        for (int i = 0; i < order; ++i)
+            mix += (response == LadderResponse::highpass ? LadderTaps::highpass : LadderTaps::bandpass)[order / 2 - 1][i] * stage[i];
+
+        return mix;
+    }
+
+    /** The linearised closed-loop response, from vin with vout = G eta e / D fed back. */
+    std::complex<double> getLadderResponse (int order, LadderResponse response, std::complex<double> p, double eta, double outputGain)
+    {
+        std::complex<double> stage[ladderMaxOrder];
+        auto denominator = getLadderStages (order, p, stage);
+
+        return getLadderNumerator (order, response, p, eta, outputGain) / (denominator + outputGain * eta);
+    }
+
+    /** The taps leave the numerators they are meant to, p^N for the highpass and p^(N/2) for the bandpass, which peaks at one. */
+    void testTapNumerators()
+    {
+        for (int order = 2; order <= ladderMaxOrder; order += 2)
+        {
+            auto maxError = 0.0, peak = 0.0;
+
+            // the weight of p^(N/2) in the bandpass, read off at p = j
+            std::complex<double> unit (0.0, 1.0), unitStages[ladderMaxOrder];
+            getLadderStages (order, unit, unitStages);
+            auto bandpassGain = getLadderNumerator (order, LadderResponse::bandpass, unit, 1.0, 0.0) / std::pow (unit, order / 2);
+
+            for (int i = -300; i <= 300; ++i)
+            {
+                std::complex<double> p (0.0, std::pow (10.0, i / 100.0)), stage[ladderMaxOrder];
+                auto denominator = getLadderStages (order, p, stage);
+
+                // measured on the response, since the numerators cancel far below the rounding of the taps at low p
+                auto highpass = getLadderNumerator (order, LadderResponse::highpass, p, 1.0, 0.0);
+                auto bandpass = getLadderNumerator (order, LadderResponse::bandpass, p, 1.0, 0.0);
+
+                maxError = std::max (maxError, std::abs ((highpass - std::pow (p, order)) / denominator));
+                maxError = std::max (maxError, std::abs ((bandpass - bandpassGain * std::pow (p, order / 2)) / denominator));
+                peak = std::max (peak, std::abs (bandpass / denominator));
+            }
+
+            check (maxError < 1.0e-10, "the taps leave p^N and p^(N/2) over the ladder's denominator", maxError);
+            check (std::abs (peak - 1.0) < 1.0e-4, "the bandpass peaks at one", peak);
+        }
+    }
+
+    /** At a low level the solver's mixed outputs follow the linearised closed-loop response, through the bilinear mapping. */
+    template <int order, LadderResponse response>
+    void testMixedResponse (const char* what)
+    {
+        const auto rate = 4.0 * 48000.0;
+        const auto window = 4800, settle = 48000;
+
+        LadderCoefficients coefficients;
+        LadderCircuit::setCoefficients (coefficients, 1000.0, 1.0, LadderCircuit::thermalVoltage, rate);
+
+        auto eta = coefficients.inputScale / coefficients.stageScale;
+        auto maxError = 0.0;
+
+        for (auto cycles : { 1, 3, 10, 30, 100, 300, 1000 }) // 40 Hz to 40 kHz
+        {
+            LadderState<1, double, ladderMaxOrder> state;
+            state.reset();
+
+            auto w = 2.0 * pi * cycles / window;
+            std::complex<double> sum;
+
+            for (int n = 0; n < settle + window; ++n)
+            {
+                auto vin = 1.0e-4 * std::sin (w * n);
+                double vout;
+                bool converged;
+
+                LadderSolver<Nonlinearities::ExactTanh, 1, double, 0, order, response>::processSample (coefficients, state, &vin, &vout, converged);
+
+                if (n >= settle)
+                    sum += vout * std::polar (1.0, -w * n);
+            }
+
+            // the trapezoidal rule maps s to 2 / T tan (w T / 2), and p is s over a / T stageScale 2
+            auto measured = std::abs (sum) * 2.0 / window / 1.0e-4;
+            std::complex<double> p (0.0, std::tan (w / 2.0) / (coefficients.a * coefficients.stageScale));
+            auto expected = std::abs (getLadderResponse (order, response, p, eta, coefficients.outputGain));
+
+            maxError = std::max (maxError, std::abs (measured - expected) / std::max (expected, 1.0e-3));
+        }
+
+        check (maxError < 1.0e-3, what, maxError);
+    }
+
+    //==============================================================================
+    /** The documented bounds of the approximated tanh kernels hold over their whole range. */
+    template <typename Kernel>
+    void testTanhError (const char* what)
+    {
+        auto maxError = 0.0;
+
+        for (int i = -200000; i <= 200000; ++i)
+        {
+            auto x = i * 1.0e-4; // [-20, 20]
+            maxError = std::max (maxError, std::abs (Kernel::process (x) - std::tanh (x)));
+        }
+
+        check (maxError <= Kernel::maxError, what, maxError);
+        check (maxError > 0.5 * Kernel::maxError, "the documented bound is tight", maxError);
+    }
+
+    /** A vectorised kernel gives every lane of a register what the scalar kernel gives that lane's argument. */
+    template <typename Kernel, typename Type>
+    void testTanhLanes (const char* what)
+    {
+        constexpr int numLanes = ladderLanesOf<Type>;
+        auto maxDifference = 0.0;
+
+        for (int i = -200000; i <= 200000; i += numLanes)
+        {
+            alignas (64) Type x[numLanes], y[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                x[lane] = (Type) ((i + lane) * 1.0e-4);
+
+            Kernel::process (LadderVector<Type, numLanes>::load (x)).store (y);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                maxDifference = std::max (maxDifference, std::abs ((double) y[lane] - (double) Kernel::process (x[lane])));
+        }
+
+        // a few ulp, for a compiler that fuses the scalar and the vector multiply-adds differently
+        check (maxDifference <= 4.0 * std::numeric_limits<Type>::epsilon(), what, maxDifference);
+    }
+
+    //==============================================================================
+    /** Up then down through a half-band pair delays a low tone by exactly getLatency() samples. */
+    void testHalfBandLatency()
+    {
+        const struct { double transition; int numCoefficients; } designs[] = { { 0.025, 8 }, { 0.125, 4 } };
+
+        for (auto design : designs)
+        {
+            double coefficients[HalfBandOversampler<double>::maxCoefficients];
+            HalfBandOversampler<double>::design (design.transition, design.numCoefficients, coefficients);
+
+            HalfBandOversampler<double> up, down;
+            up.setCoefficients (coefficients, design.numCoefficients);
+            down.setCoefficients (coefficients, design.numCoefficients);
+
+            const int numSamples = 8192;
+            const auto frequency = 1.0 / 512.0; // cycles per sample, low enough for a flat group delay and a whole number of cycles in the window
+            std::vector<double> input ((size_t) numSamples), upsampled ((size_t) (2 * numSamples)), output ((size_t) numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                input[(size_t) i] = std::sin (2.0 * pi * frequency * i);
+
+            up.upsample (input.data(), 1, upsampled.data(), numSamples);
+            down.downsample (upsampled.data(), output.data(), 1, numSamples);
+
+            // the phase of the output against the input, over the settled second half
+            auto inPhase = 0.0, quadrature = 0.0;
+
+            for (int i = numSamples / 2; i < numSamples; ++i)
+            {
+                inPhase += output[(size_t) i] * std::sin (2.0 * pi * frequency * i);
+                quadrature += output[(size_t) i] * std::cos (2.0 * pi * frequency * i);
+            }
+
+            auto measured = -std::atan2 (quadrature, inPhase) / (2.0 * pi * frequency);
+            auto latency = HalfBandOversampler<double>::getLatency (coefficients, design.numCoefficients);
+
+            check (std::abs (measured - latency) < 0.05, "measured half-band latency matches getLatency()", measured - latency);
+        }
+    }
+
+    //==============================================================================
+    std::vector<float> makeChannel (int channel, int numFrames)
+    {
+        std::vector<float> samples ((size_t) numFrames);
+
+        for (int i = 0; i < numFrames; ++i)
+            samples[(size_t) i] = (float) (0.5 * std::sin (2.0 * pi * (110.0 + 70.0 * channel) * i / 48000.0));
+
+        return samples;
+    }
+
+    /** At 1x the core runs the plugin's ladder path: the shared parameter ramps evaluated at the end of each
+        sub-block, LadderCircuit's coefficients at that point, the coefficient ramp up to it and the solver,
+        chained the way VCFAudioProcessor::processBlock chains them. Only the oversamplers differ.
+    */
+    void testEngineMatchesPluginLadder()
+    {
+        constexpr int numLanes = ladderLanesOf<float>;
+        const auto rate = 48000.0;
+        const int numChannels = 2, blockFrames = 512, numBlocks = 24;
+        const auto rampSamples = (int) (LadderEngine::parameterRampSeconds * rate);
+
+        LadderEngine engine;
+        engine.setOversamplingStages (0);
+        engine.setCutoff (800.0);
+        engine.setFeedback (2.5);
+        engine.prepare (rate, numChannels);
+
+        LadderParameterRamp octave, feedback, vt;
+        octave.reset (std::log2 (800.0));
+        feedback.reset (2.5);
+        vt.reset (LadderCircuit::thermalVoltage);
+
+        LadderCoefficients coefficients, target;
+        LadderCoefficientRamp ramp;
+        LadderState<numLanes, float, ladderMaxOrder> state;
+        state.reset();
+
+        std::vector<std::vector<float>> channels;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels.push_back (makeChannel (channel, blockFrames * numBlocks));
+
+        auto maxDifference = 0.0;
+        auto snap = true;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // automation halfway through, which both ramp over the next 20 ms
+            if (block == numBlocks / 2)
+            {
+                engine.setCutoff (2000.0);
+                engine.setFeedback (3.5);
+                engine.setThermalVoltage (0.02);
+                octave.setTarget (std::log2 (2000.0), rampSamples);
+                feedback.setTarget (3.5, rampSamples);
+                vt.setTarget (0.02, rampSamples);
+            }
+
+            std::vector<float> output[numChannels];
+            const float* input[numChannels];
+            float* outputs[numChannels];
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                output[channel].resize ((size_t) blockFrames);
+                input[channel] = channels[(size_t) channel].data() + block * blockFrames;
+                outputs[channel] = output[channel].data();
+            }
+
+            engine.process (input, outputs, 1, blockFrames);
+
+            for (int start = 0; start < blockFrames; start += LadderEngine::subBlockSamples)
+            {
+                auto numSamples = std::min (LadderEngine::subBlockSamples, blockFrames - start);
+
+                LadderCircuit::setCoefficients (target, std::exp2 (octave.skip (numSamples)), feedback.skip (numSamples), vt.skip (numSamples), rate);
+                target.setPredictor (LadderPredictor::quadratic);
+
+                if (snap)
+                    coefficients = target;
+
+                snap = false;
+                ramp.set (coefficients, target, numSamples);
+
+                for (int i = start; i < start + numSamples; ++i)
+                {
+                    float vin[numLanes] = {}, vout[numLanes];
+                    bool converged;
+
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        vin[channel] = input[channel][i];
+
+                    if (ramp.active)
+                        ramp.apply (coefficients);
+
+                    LadderSolver<Nonlinearities::ExactTanh, numLanes, float>::processSample (coefficients, state, vin, vout, converged);
+
+                    for (int channel = 0; channel < numChannels; ++channel)
+                        maxDifference = std::max (maxDifference, (double) std::abs (vout[channel] - output[channel][(size_t) i]));
+                }
+
+                coefficients = target;
+            }
+        }
+
+        check (maxDifference == 0.0, "the core at 1x matches the plugin's ladder path exactly", maxDifference);
+    }
+
+    /** Planar and interleaved buffers, in place or not, in blocks of any length, give the same output. */
+    void testPlanarMatchesInterleaved()
+    {
+        const int numChannels = 3, numFrames = 6000;
+
+        for (int stages = 0; stages <= LadderEngine::maxOversamplingStages; ++stages)
+        {
+            vcf_core* planar = vcf_create();
+            vcf_core* interleaved = vcf_create();
+
+            for (auto* core : { planar, interleaved })
+            {
+                vcf_set_parameter (core, VCF_PARAMETER_OVERSAMPLING, stages);
+                vcf_set_parameter (core, VCF_PARAMETER_CUTOFF, 3000.0);
+                vcf_set_parameter (core, VCF_PARAMETER_FEEDBACK, 2.5);
+                check (vcf_prepare (core, 48000.0, numChannels) == VCF_OK, "vcf_prepare");
+            }
+
+            std::vector<std::vector<float>> channels;
+            std::vector<float> frames ((size_t) (numChannels * numFrames));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                channels.push_back (makeChannel (channel, numFrames));
+
+                for (int i = 0; i < numFrames; ++i)
+                    frames[(size_t) (i * numChannels + channel)] = channels.back()[(size_t) i];
+            }
+
+            std::vector<float> planarOutput ((size_t) numFrames);
+
+            for (int start = 0, length = 1; start < numFrames; start += length, length = length * 3 % 1001 + 1)
+            {
+                length = std::min (length, numFrames - start);
+
+                // channel 0 goes to a separate buffer, the others are processed in place
+                const float* input[numChannels] = { channels[0].data() + start, channels[1].data() + start, channels[2].data() + start };
+                float* output[numChannels] = { planarOutput.data() + start, channels[1].data() + start, channels[2].data() + start };
+                check (vcf_process_planar (planar, input, output, length) == VCF_OK, "vcf_process_planar");
+            }
+
+            for (int start = 0; start < numFrames; start += 512)
+            {
+                auto length = std::min (512, numFrames - start);
+                auto* block = frames.data() + start * numChannels;
+                check (vcf_process_interleaved (interleaved, block, block, length) == VCF_OK, "vcf_process_interleaved");
+            }
+
+            auto maxDifference = 0.0, peak = 0.0;
+
+            for (int i = 0; i < numFrames; ++i)
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    auto value = channel == 0 ? planarOutput[(size_t) i] : channels[(size_t) channel][(size_t) i];
+                    maxDifference = std::max (maxDifference, (double) std::abs (value - frames[(size_t) (i * numChannels + channel)]));
+                    peak = std::max (peak, (double) std::abs (value));
+                }
+            }
+
+            check (maxDifference == 0.0, "planar and interleaved outputs are identical", maxDifference);
+            check (peak > 0.05 && peak < 2.0, "the filtered output has a sane level", peak);
+
+            vcf_destroy (planar);
+            vcf_destroy (interleaved);
+        }
+    }
+
+    /** Bad arguments are refused, and values out of range are clamped rather than trusted. */
+    void testParameterValidation()
+    {
+        vcf_core* core = vcf_create();
+        const auto infinity = std::numeric_limits<double>::infinity();
+        const auto nan = std::numeric_limits<double>::quiet_NaN();
+        float sample = 0.0f;
+        float* channel = &sample;
+
+        check (vcf_process_interleaved (core, &sample, &sample, 1) == VCF_ERROR_NOT_PREPARED, "processing before vcf_prepare");
+        check (vcf_prepare (core, 0.0, 2) == VCF_ERROR_INVALID_ARGUMENT, "a zero sample rate");
+        check (vcf_prepare (core, nan, 2) == VCF_ERROR_INVALID_ARGUMENT, "a NaN sample rate");
+        check (vcf_prepare (core, 48000.0, 0) == VCF_ERROR_INVALID_ARGUMENT, "no channels");
+        check (vcf_prepare (core, 48000.0, LadderEngine::maxChannels + 1) == VCF_ERROR_INVALID_ARGUMENT, "too many channels");
+        check (vcf_prepare (nullptr, 48000.0, 2) == VCF_ERROR_INVALID_ARGUMENT, "a null core");
+        check (vcf_process_planar (core, nullptr, &channel, 1) == VCF_ERROR_INVALID_ARGUMENT, "a null input");
+
+        check (vcf_set_parameter (core, VCF_PARAMETER_FEEDBACK, nan) == VCF_ERROR_INVALID_ARGUMENT, "a NaN value");
+        check (vcf_set_parameter (core, (vcf_parameter) 7, 1.0) == VCF_ERROR_INVALID_ARGUMENT, "an unknown parameter");
+
+        for (auto parameter : { VCF_PARAMETER_QUALITY, VCF_PARAMETER_OVERSAMPLING, VCF_PARAMETER_ORDER, VCF_PARAMETER_FIXED_COST })
+        {
+            check (vcf_set_parameter (core, parameter, infinity) == VCF_ERROR_INVALID_ARGUMENT, "an infinite choice", parameter);
+            check (vcf_set_parameter (core, parameter, -infinity) == VCF_ERROR_INVALID_ARGUMENT, "a negative infinite choice", parameter);
+        }
+
+        vcf_set_parameter (core, VCF_PARAMETER_OVERSAMPLING, 1.0e12);
+        vcf_set_parameter (core, VCF_PARAMETER_QUALITY, -1.0e300);
+        vcf_set_parameter (core, VCF_PARAMETER_ORDER, 5.0);
+        vcf_set_parameter (core, VCF_PARAMETER_FEEDBACK, infinity);
+        vcf_set_parameter (core, VCF_PARAMETER_THERMAL_VOLTAGE, -1.0);
+
+        check (vcf_get_parameter (core, VCF_PARAMETER_OVERSAMPLING) == LadderEngine::maxOversamplingStages, "oversampling clamped to its top");
+        check (vcf_get_parameter (core, VCF_PARAMETER_QUALITY) == 0.0, "quality clamped to its bottom");
+        check (vcf_get_parameter (core, VCF_PARAMETER_ORDER) == 4.0, "an odd order rounded to an even one");
+        check (vcf_get_parameter (core, VCF_PARAMETER_FEEDBACK) == LadderEngine::maxFeedback, "feedback clamped to its top");
+        check (vcf_get_parameter (core, VCF_PARAMETER_THERMAL_VOLTAGE) == LadderEngine::minThermalVoltage, "Vt clamped to its bottom");
+
+        vcf_destroy (core);
+    }
+
+    /** A cutoff far above the rate, set before prepare, runs at the highest cutoff the rate allows from the first sample. */
+    void testCutoffLimitedFromTheStart()
+    {
+        const int numFrames = 48000;
+        auto peakFor = [numFrames] (double cutoff)
+        {
+            vcf_core* core = vcf_create();
+            vcf_set_parameter (core, VCF_PARAMETER_CUTOFF, cutoff);
+            vcf_prepare (core, 48000.0, 1);
+
+            std::vector<float> samples ((size_t) numFrames);
+
+            for (int i = 0; i < numFrames; ++i)
+                samples[(size_t) i] = (float) (0.3 * std::sin (2.0 * pi * 440.0 * i / 48000.0));
+
+            float* channel = samples.data();
+            vcf_process_planar (core, &channel, &channel, numFrames);
+            vcf_destroy (core);
+
+            auto peak = 0.0f;
+
+            for (auto value : samples)
+                peak = std::max (peak, std::abs (value));
+
+            return (double) peak;
+        };
+
+        auto limited = peakFor (1.0e6);
+        check (std::abs (limited - peakFor (LadderEngine::maxCutoffRatio * 48000.0)) < 1.0e-3,
+               "a cutoff above the rate behaves as the highest one", limited);
+    }
+}
+
+//==============================================================================
+int main()
+{
+    testNewtonAgainstReference();
+    testOrderFourAgainstUnrolled();
+    testLanesAreIndependent();
+    testLinkedLanesMatch();
+    testArgumentsKeptForAntialiasing();
+    testAntialiasingReducesAliases();
+    testLinearBelowMaxDrive();
+    testTapNumerators();
+    testMixedResponse<4, LadderResponse::lowpass> ("the lowpass follows the linearised ladder");
+    testMixedResponse<4, LadderResponse::highpass> ("the highpass of four stages follows the linearised ladder");
+    testMixedResponse<4, LadderResponse::bandpass> ("the bandpass of four stages follows the linearised ladder");
+    testMixedResponse<8, LadderResponse::highpass> ("the highpass of eight stages follows the linearised ladder");
+    testMixedResponse<2, LadderResponse::bandpass> ("the bandpass of two stages follows the linearised ladder");
+    testTanhError<Nonlinearities::PadeTanh> ("Pade tanh within its documented error");
+    testTanhError<Nonlinearities::TableTanh> ("table tanh within its documented error");
+    testTanhLanes<Nonlinearities::PadeTanh, double> ("Pade tanh on a double register matches the scalar kernel");
+    testTanhLanes<Nonlinearities::PadeTanh, float> ("Pade tanh on a float register matches the scalar kernel");
+    testHalfBandLatency();
+    testEngineMatchesPluginLadder();
+    testPlanarMatchesInterleaved();
+    testParameterValidation();
+    testCutoffLimitedFromTheStart();
+
+    if (failures == 0)
+        std::printf ("All checks passed\n");
+
+    return failures;
+}
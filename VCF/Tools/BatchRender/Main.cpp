@@ -0,0 +1,488 @@
+/*
+  ==============================================================================
+
+    Batch offline renderer for VCFAudioProcessor.
+
+    Renders every input file of a JSON manifest with every parameter set it
+    lists, on one processor per worker thread. Files are streamed through in
+    large blocks, straight out of the mapped file for WAV and AIFF, so neither
+    an input nor an output is ever held in memory whole.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+namespace
+{
+    const char* const usage =
+        "Usage: VCFBatch --manifest <file.json> [options]\n"
+        "\n"
+        "  --manifest <file>     files and parameter sets to render, see below\n"
+        "  --threads <n>         worker threads, each running a processor of its own (default: one per CPU)\n"
+        "  --skip-existing       keep outputs that are already there, to resume an interrupted batch\n"
+        "\n"
+        "Manifest:\n"
+        "\n"
+        "  {\n"
+        "    \"files\": [ \"drums\", \"bass/take1.wav\" ],    files, or folders that are searched recursively\n"
+        "    \"output\": \"renders\",                        output folder (default: renders)\n"
+        "    \"blockSize\": 8192,                           samples read, processed and written at a time (default: 8192)\n"
+        "    \"bitDepth\": 24,                              16, 24 or 32 bit float WAV (default: 24)\n"
+        "    \"precision\": \"float\",                        float or double (default: float)\n"
+        "    \"maxTailSeconds\": 5,                         cap on the ringing rendered past the end (default: 5)\n"
+        "    \"parameters\": { \"oversampling_ID\": \"8x\" },   applied before each preset's own\n"
+        "    \"presets\": [ { \"name\": \"dark\", \"parameters\": { \"controlF0_ID\": 300, \"quality_ID\": \"Pade\" } } ]\n"
+        "  }\n"
+        "\n"
+        "Paths are relative to the manifest. Every file is rendered once per preset, to\n"
+        "<output>/<file>_<preset>.wav. A number sets a parameter to that value, or a choice\n"
+        "to that index as with VCFRender; a string sets it to the text the parameter shows.\n"
+        "Parameters a preset leaves out are at their defaults.\n";
+
+    //==============================================================================
+    struct Preset
+    {
+        juce::String name;
+        juce::NamedValueSet parameters;
+    };
+
+    struct Settings
+    {
+        int blockSize = 8192;
+        int bitDepth = 24;
+        bool doublePrecision = false;
+        double maxTailSeconds = 5.0;
+        juce::NamedValueSet parameters;
+        juce::Array<Preset> presets;
+    };
+
+    struct Job
+    {
+        juce::File input, output;
+        int preset = 0;
+    };
+
+    juce::NamedValueSet getProperties (const juce::var& object)
+    {
+        if (auto* dynamicObject = object.getDynamicObject())
+            return dynamicObject->getProperties();
+
+        return {};
+    }
+
+    bool loadManifest (const juce::File& file, Settings& settings, juce::Array<juce::File>& inputs,
+                       juce::File& outputFolder, juce::String& error)
+    {
+        juce::var manifest;
+        auto result = juce::JSON::parse (file.loadFileAsString(), manifest);
+
+        if (result.failed() || ! manifest.isObject())
+        {
+            error = "Could not parse " + file.getFullPathName() + " " + result.getErrorMessage();
+            return false;
+        }
+
+        auto folder = file.getParentDirectory();
+        outputFolder = folder.getChildFile (manifest.getProperty ("output", "renders").toString());
+
+        settings.blockSize = juce::jlimit (64, 1 << 20, (int) manifest.getProperty ("blockSize", settings.blockSize));
+        settings.bitDepth = (int) manifest.getProperty ("bitDepth", settings.bitDepth);
+        settings.doublePrecision = manifest.getProperty ("precision", "float").toString().equalsIgnoreCase ("double");
+        settings.maxTailSeconds = juce::jmax (0.0, (double) manifest.getProperty ("maxTailSeconds", settings.maxTailSeconds));
+        settings.parameters = getProperties (manifest["parameters"]);
+
+        if (settings.bitDepth != 16 && settings.bitDepth != 24 && settings.bitDepth != 32)
+        {
+            error = "Unsupported bit depth " + juce::String (settings.bitDepth);
+            return false;
+        }
+
+        if (auto* presets = manifest["presets"].getArray())
+            for (auto& preset : *presets)
+                settings.presets.add ({ preset["name"].toString(), getProperties (preset["parameters"]) });
+
+        if (settings.presets.isEmpty())
+            settings.presets.add ({});
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        if (auto* files = manifest["files"].getArray())
+        {
+            for (auto& path : *files)
+            {
+                auto entry = folder.getChildFile (path.toString());
+
+                if (entry.isDirectory())
+                {
+                    auto found = entry.findChildFiles (juce::File::findFiles, true, formats.getWildcardForAllFormats());
+                    found.sort();
+                    inputs.addArray (found);
+                }
+                else if (entry.existsAsFile())
+                {
+                    inputs.add (entry);
+                }
+                else
+                {
+                    error = "No such file " + entry.getFullPathName();
+                    return false;
+                }
+            }
+        }
+
+        if (inputs.isEmpty())
+            error = "The manifest lists no input files";
+
+        return ! inputs.isEmpty();
+    }
+
+    /** Checks the names, and the texts of choices, before any worker starts on them. */
+    bool checkParameters (VCFAudioProcessor& processor, const juce::NamedValueSet& values, juce::String& error)
+    {
+        for (auto& value : values)
+        {
+            auto* parameter = processor.audioTree.getParameter (value.name.toString());
+
+            if (parameter == nullptr)
+            {
+                error = "Unknown parameter " + value.name.toString();
+                return false;
+            }
+
+            auto* choice = dynamic_cast<juce::AudioParameterChoice*> (parameter);
+
+            if (choice != nullptr && value.value.isString() && ! choice->choices.contains (value.value.toString()))
+            {
+                error = "Unknown " + value.name.toString() + " setting " + value.value.toString();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void setParameters (VCFAudioProcessor& processor, const juce::NamedValueSet& values)
+    {
+        for (auto& value : values)
+            if (auto* parameter = processor.audioTree.getParameter (value.name.toString()))
+                parameter->setValueNotifyingHost (value.value.isString() ? parameter->getValueForText (value.value.toString())
+                                                                         : parameter->convertTo0to1 ((float) value.value));
+    }
+
+    //==============================================================================
+    /** Totals of the batch, reported to as the workers finish their files. */
+    class Progress
+    {
+    public:
+        explicit Progress (int numJobsToRender) : numJobs (numJobsToRender) {}
+
+        void finished (const Job& job, double audioSeconds, double seconds)
+        {
+            const juce::ScopedLock sl (lock);
+            ++numDone;
+            totalAudioSeconds += audioSeconds;
+            bytesRead += job.input.getSize();
+
+            std::cout << numDone << "/" << numJobs << "\t" << job.output.getFullPathName() << "\t"
+                      << juce::String (audioSeconds / juce::jmax (seconds, 1.0e-9), 1) << "x" << std::endl;
+        }
+
+        void skipped (const Job& job)
+        {
+            const juce::ScopedLock sl (lock);
+            ++numDone;
+            std::cout << numDone << "/" << numJobs << "\t" << job.output.getFullPathName() << "\texists" << std::endl;
+        }
+
+        void failed (const Job& job, const juce::String& error)
+        {
+            const juce::ScopedLock sl (lock);
+            ++numDone;
+            ++numFailed;
+            std::cerr << numDone << "/" << numJobs << "\t" << job.input.getFullPathName() << "\t" << error << std::endl;
+        }
+
+        int getNumFailed() const            { const juce::ScopedLock sl (lock); return numFailed; }
+        double getTotalAudioSeconds() const { const juce::ScopedLock sl (lock); return totalAudioSeconds; }
+        juce::int64 getBytesRead() const    { const juce::ScopedLock sl (lock); return bytesRead; }
+
+    private:
+        juce::CriticalSection lock;
+        const int numJobs;
+        int numDone = 0, numFailed = 0;
+        double totalAudioSeconds = 0.0;
+        juce::int64 bytesRead = 0;
+    };
+
+    //==============================================================================
+    /** Takes the next job of the batch until none are left, rendering each on a processor of its own. */
+    class Worker  : public juce::Thread
+    {
+    public:
+        Worker (const Settings& batchSettings, const juce::Array<Job>& batchJobs, std::atomic<int>& nextJobIndex,
+                Progress& batchProgress, bool skipExistingOutputs, int index)
+            : juce::Thread ("VCFBatch worker " + juce::String (index)),
+              settings (batchSettings), jobs (batchJobs), nextJob (nextJobIndex), progress (batchProgress),
+              skipExisting (skipExistingOutputs)
+        {
+            formats.registerBasicFormats();
+
+            // the batch already keeps every core busy with a file of its own, and
+            // renders offline, so the governor never trades away quality
+            processor.setMaxWorkers (0);
+            processor.setNonRealtime (true);
+        }
+
+        VCFAudioProcessor processor;
+
+        void run() override
+        {
+            juce::ScopedNoDenormals noDenormals;
+
+            for (auto index = nextJob++; index < jobs.size() && ! threadShouldExit(); index = nextJob++)
+            {
+                auto& job = jobs.getReference (index);
+
+                if (skipExisting && job.output.existsAsFile())
+                {
+                    progress.skipped (job);
+                    continue;
+                }
+
+                auto start = juce::Time::getHighResolutionTicks();
+                double audioSeconds = 0.0;
+                juce::String error;
+
+                if (render (job, audioSeconds, error))
+                    progress.finished (job, audioSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+                else
+                    progress.failed (job, error);
+            }
+        }
+
+    private:
+        std::unique_ptr<juce::AudioFormatReader> openReader (const juce::File& file)
+        {
+            // WAV and AIFF are read straight out of the mapped file, which the OS pages in as the blocks get to it
+            juce::AudioFormat* const mappable[] = { &wav, &aiff };
+
+            for (auto* format : mappable)
+            {
+                if (format->canHandleFile (file))
+                {
+                    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+
+                    if (mapped != nullptr && mapped->mapEntireFile())
+                        return mapped;
+                }
+            }
+
+            return std::unique_ptr<juce::AudioFormatReader> (formats.createReaderFor (file));
+        }
+
+        bool render (const Job& job, double& audioSeconds, juce::String& error)
+        {
+            auto reader = openReader (job.input);
+
+            if (reader == nullptr)
+            {
+                error = "Could not read the file";
+                return false;
+            }
+
+            auto numChannels = (int) reader->numChannels;
+            auto sampleRate = reader->sampleRate;
+            auto layout = processor.getBusesLayout();
+
+            layout.inputBuses.getReference (0) = layout.outputBuses.getReference (0) = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+
+            if (layout.inputBuses.size() > 1)
+                layout.inputBuses.getReference (1) = juce::AudioChannelSet::disabled();
+
+            if (numChannels < 1 || numChannels > VCFAudioProcessor::maxChannels || ! processor.setBusesLayout (layout))
+            {
+                error = "Unsupported channel count " + juce::String (numChannels);
+                return false;
+            }
+
+            // every preset starts from the defaults, whatever the previous file on this worker used
+            for (auto* parameter : processor.getParameters())
+                parameter->setValueNotifyingHost (parameter->getDefaultValue());
+
+            setParameters (processor, settings.parameters);
+            setParameters (processor, settings.presets.getReference (job.preset).parameters);
+
+            processor.setProcessingPrecision (settings.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                                       : juce::AudioProcessor::singlePrecision);
+            processor.setRateAndBufferSizeDetails (sampleRate, settings.blockSize);
+            processor.prepareToPlay (sampleRate, settings.blockSize);
+
+            // written next to the output and moved over it once complete, so a failed render leaves no partial file
+            juce::TemporaryFile temporary (job.output);
+            std::unique_ptr<juce::FileOutputStream> stream (temporary.getFile().createOutputStream (outputBufferSize));
+            std::unique_ptr<juce::AudioFormatWriter> writer;
+
+            if (stream != nullptr)
+                writer.reset (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels, settings.bitDepth, {}, 0));
+
+            if (writer == nullptr)
+            {
+                processor.releaseResources();
+                error = "Could not write " + job.output.getFullPathName();
+                return false;
+            }
+
+            stream.release(); // now owned by the writer
+
+            // the latency is cut from the front, so the output lines up with the input, and the
+            // tail rings out past the end; beyond its length the reader pads with silence
+            auto latency = (juce::int64) processor.getLatencySamples();
+            auto tail = (juce::int64) std::ceil (juce::jmin (processor.getTailLengthSeconds(), settings.maxTailSeconds) * sampleRate);
+            auto end = latency + reader->lengthInSamples + tail;
+            auto ok = true;
+
+            for (juce::int64 position = 0; position < end && ok; position += settings.blockSize)
+            {
+                auto numSamples = (int) juce::jmin ((juce::int64) settings.blockSize, end - position);
+                auto skip = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numSamples, latency - position);
+
+                // sized down for the last block without giving up the allocation
+                buffer.setSize (numChannels, numSamples, false, false, true);
+                ok = reader->read (&buffer, 0, numSamples, position, true, true);
+
+                if (settings.doublePrecision)
+                {
+                    doubleBuffer.makeCopyOf (buffer, true);
+                    processor.processBlock (doubleBuffer, midi);
+                    buffer.makeCopyOf (doubleBuffer, true);
+                }
+                else
+                {
+                    processor.processBlock (buffer, midi);
+                }
+
+                ok = ok && writer->writeFromAudioSampleBuffer (buffer, skip, numSamples - skip);
+            }
+
+            writer.reset();
+            processor.releaseResources();
+
+            if (! ok || ! temporary.overwriteTargetFileWithTemporary())
+            {
+                error = "Could not render to " + job.output.getFullPathName();
+                return false;
+            }
+
+            audioSeconds = (double) (end - latency) / sampleRate;
+            return true;
+        }
+
+        static constexpr size_t outputBufferSize = 1 << 20;
+
+        const Settings& settings;
+        const juce::Array<Job>& jobs;
+        std::atomic<int>& nextJob;
+        Progress& progress;
+        const bool skipExisting;
+
+        juce::AudioFormatManager formats;
+        juce::WavAudioFormat wav;
+        juce::AiffAudioFormat aiff;
+        juce::AudioBuffer<float> buffer;
+        juce::AudioBuffer<double> doubleBuffer;
+        juce::MidiBuffer midi;
+
+        JUCE_DECLARE_NON_COPYABLE (Worker)
+    };
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h") || ! args.containsOption ("--manifest"))
+    {
+        std::cout << usage;
+        return args.containsOption ("--help|-h") ? 0 : 1;
+    }
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Settings settings;
+    juce::Array<juce::File> inputs;
+    juce::File outputFolder;
+    juce::String error;
+
+    if (! loadManifest (args.getExistingFileForOption ("--manifest"), settings, inputs, outputFolder, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    if (! outputFolder.createDirectory())
+    {
+        std::cerr << "Could not create " << outputFolder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    juce::Array<Job> jobs;
+
+    for (auto& input : inputs)
+    {
+        for (int preset = 0; preset < settings.presets.size(); ++preset)
+        {
+            auto& name = settings.presets.getReference (preset).name;
+            auto fileName = input.getFileNameWithoutExtension() + (name.isEmpty() ? juce::String() : "_" + name) + ".wav";
+            jobs.add ({ input, outputFolder.getChildFile (juce::File::createLegalFileName (fileName)), preset });
+        }
+    }
+
+    auto numThreads = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                        : juce::SystemStats::getNumCpus();
+    numThreads = juce::jlimit (1, jobs.size(), numThreads);
+
+    std::atomic<int> nextJob { 0 };
+    Progress progress (jobs.size());
+    juce::OwnedArray<Worker> workers;
+
+    for (int i = 0; i < numThreads; ++i)
+        workers.add (new Worker (settings, jobs, nextJob, progress, args.containsOption ("--skip-existing"), i));
+
+    auto& checker = workers.getFirst()->processor;
+
+    if (! checkParameters (checker, settings.parameters, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    for (auto& preset : settings.presets)
+    {
+        if (! checkParameters (checker, preset.parameters, error))
+        {
+            std::cerr << "Preset " << preset.name << ": " << error << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = juce::Time::getHighResolutionTicks();
+
+    for (auto* worker : workers)
+        worker->startThread();
+
+    for (auto* worker : workers)
+        worker->waitForThreadToExit (-1);
+
+    auto seconds = juce::jmax (1.0e-9, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+
+    std::cout << "Rendered " << jobs.size() - progress.getNumFailed() << " of " << jobs.size() << " files on " << numThreads << " threads, "
+              << juce::String (progress.getTotalAudioSeconds(), 1) << " s of audio in " << juce::String (seconds, 1) << " s ("
+              << juce::String (progress.getTotalAudioSeconds() / seconds, 1) << "x realtime, "
+              << juce::String ((double) progress.getBytesRead() / (seconds * 1.0e6), 1) << " MB/s read)" << std::endl;
+
+    return progress.getNumFailed() > 0 ? 1 : 0;
+}
@@ -0,0 +1,416 @@
+/*
+  ==============================================================================
+
+    Offline renderer and throughput benchmark for VCFAudioProcessor.
+
+    Runs WAV files or synthetic test signals through the processor without a
+    host or editor, and reports realtime factor, processing time per sample
+    and solver iterations for every combination of the swept settings.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+namespace
+{
+    const char* const usage =
+        "Usage: VCFRender [options]\n"
+        "\n"
+        "  --in <file>           render an audio file (default: a synthetic signal)\n"
+        "  --signal <type>       sine, sweep, noise or impulse (default: sweep)\n"
+        "  --seconds <s>         length of the synthetic signal (default: 10)\n"
+        "  --out <file.wav>      write the rendered audio, numbered per run when sweeping\n"
+        "  --rate <list>         sample rates in Hz (default: file rate or 48000)\n"
+        "  --block <list>        host block sizes (default: 512)\n"
+        "  --k <list>            controlK_ID values (default: 0.5)\n"
+        "  --f0 <list>           controlF0_ID values in Hz (default: 1000)\n"
+        "  --vt <list>           controlVt_ID values (default: 0.026)\n"
+        "  --quality <list>      exact, pade, table and/or adaa (default: exact)\n"
+        "  --oversampling <list> oversampling factors 1, 2, 4, 8 or 16 (default: 4)\n"
+        "  --filter <list>       oversampling filter, iir and/or fir (default: iir)\n"
+        "  --predictor <list>    solver initial guess, previous, linear and/or quadratic (default: quadratic)\n"
+        "  --fm <list>           sine CV on the sidechain at this rate in Hz, 0 = sidechain off (default: 0)\n"
+        "  --precision <list>    processing precision, float and/or double (default: float)\n"
+        "  --eco <list>          linear ladder on low drive, off and/or on (default: off)\n"
+        "  --solver <list>       converge and/or fixed, a fixed Newton step count per sample (default: converge)\n"
+        "  --order <list>        ladder poles, 2, 4, 6 and/or 8 (default: 4)\n"
+        "  --voices <list>       notes held in the polyphonic mode, 0 = polyphony off (default: 0)\n"
+        "  --channels <list>     main bus channels, 1 to 16, fed alternately from the signal's two (default: 2)\n"
+        "  --link <list>         stereo link, off and/or auto; the synthetic signals are dual-mono (default: off)\n"
+        "  --telemetry <file>    append the telemetry CSV to this file while rendering\n"
+        "  --repeat <n>          renders per run, the fastest one is reported (default: 1)\n"
+        "\n"
+        "Lists are comma separated, e.g. --k 0.5,2,3.9 --block 64,512,2048\n";
+
+    //==============================================================================
+    juce::StringArray parseNames (const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultValue)
+    {
+        juce::StringArray names;
+
+        if (args.containsOption (option))
+            names.addTokens (args.getValueForOption (option).toLowerCase(), ",", {});
+
+        names.trim();
+        names.removeEmptyStrings();
+
+        if (names.isEmpty())
+            names.add (defaultValue);
+
+        return names;
+    }
+
+    juce::Array<double> parseList (const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        juce::Array<double> values;
+
+        if (args.containsOption (option))
+            for (auto& item : juce::StringArray::fromTokens (args.getValueForOption (option), ",", {}))
+                values.add (item.trim().getDoubleValue());
+
+        if (values.isEmpty())
+            values.add (defaultValue);
+
+        return values;
+    }
+
+    juce::AudioBuffer<float> makeSignal (const juce::String& type, double sampleRate, double seconds)
+    {
+        auto numSamples = juce::jmax (1, juce::roundToInt (sampleRate * seconds));
+        juce::AudioBuffer<float> signal (2, numSamples);
+        signal.clear();
+
+        auto* data = signal.getWritePointer (0);
+        juce::Random random (0x5eed);
+
+        if (type == "sine")
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = 0.5f * (float) std::sin (juce::MathConstants<double>::twoPi * 220.0 * i / sampleRate);
+        }
+        else if (type == "noise")
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = 0.5f * (random.nextFloat() * 2.0f - 1.0f);
+        }
+        else if (type == "impulse")
+        {
+            data[0] = 1.0f;
+        }
+        else
+        {
+            // exponential sweep from 20 Hz to just below Nyquist
+            auto startFrequency = 20.0, endFrequency = juce::jmin (20000.0, 0.45 * sampleRate);
+            auto rate = std::log (endFrequency / startFrequency) / seconds;
+            auto phaseScale = juce::MathConstants<double>::twoPi * startFrequency / rate;
+
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = 0.5f * (float) std::sin (phaseScale * (std::exp (rate * i / sampleRate) - 1.0));
+        }
+
+        signal.copyFrom (1, 0, signal, 0, 0, numSamples);
+        return signal;
+    }
+
+    bool loadFile (const juce::File& file, juce::AudioBuffer<float>& signal, double& fileRate)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+
+        if (reader == nullptr)
+            return false;
+
+        signal.setSize (2, (int) reader->lengthInSamples);
+        reader->read (&signal, 0, (int) reader->lengthInSamples, 0, true, true);
+        fileRate = reader->sampleRate;
+        return true;
+    }
+
+    bool writeFile (const juce::File& file, const juce::AudioBuffer<float>& signal, double sampleRate)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate,
+                                                                              (unsigned int) signal.getNumChannels(),
+                                                                              24, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        stream.release(); // now owned by the writer
+        return writer->writeFromAudioSampleBuffer (signal, 0, signal.getNumSamples());
+    }
+
+    void setParameter (VCFAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.audioTree.getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    //==============================================================================
+    struct Result
+    {
+        double seconds = 0.0;
+        VCFAudioProcessor::SolverStats stats;
+    };
+
+    template <typename SampleType>
+    Result render (VCFAudioProcessor& processor, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                   double sampleRate, int blockSize, double fmFrequency, int numVoices, int numMainChannels)
+    {
+        // the sidechain carries a full-scale sine CV when rendering with --fm
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference (0) = layout.outputBuses.getReference (0) = juce::AudioChannelSet::canonicalChannelSet (numMainChannels);
+
+        if (layout.inputBuses.size() > 1)
+            layout.inputBuses.getReference (1) = fmFrequency > 0.0 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::disabled();
+
+        processor.setBusesLayout (layout);
+        processor.setProcessingPrecision (std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision
+                                                                                   : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+        processor.resetSolverStats();
+
+        // converted outside the timed loop, so both precisions are measured on their native buffers
+        juce::AudioBuffer<SampleType> signal (numMainChannels, input.getNumSamples());
+
+        for (int channel = 0; channel < numMainChannels; ++channel)
+            for (int i = 0; i < signal.getNumSamples(); ++i)
+                signal.setSample (channel, i, (SampleType) input.getSample (channel % input.getNumChannels(), i));
+
+        juce::AudioBuffer<SampleType> cv (1, signal.getNumSamples());
+
+        for (int i = 0; i < cv.getNumSamples(); ++i)
+            cv.setSample (0, i, (SampleType) std::sin (juce::MathConstants<double>::twoPi * fmFrequency * i / sampleRate));
+
+        juce::Array<SampleType*> channels;
+
+        for (int channel = 0; channel < numMainChannels; ++channel)
+            channels.add (signal.getWritePointer (channel));
+
+        if (fmFrequency > 0.0 && processor.getBusCount (true) > 1)
+            channels.add (cv.getWritePointer (0));
+
+        auto numChannels = channels.size();
+        juce::MidiBuffer midi, notes;
+        juce::ScopedNoDenormals noDenormals;
+
+        // --voices holds that many notes from the first block on, a minor third apart
+        for (int voice = 0; voice < numVoices; ++voice)
+            notes.addEvent (juce::MidiMessage::noteOn (1, 36 + 3 * voice, 0.8f), 0);
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (int position = 0; position < signal.getNumSamples(); position += blockSize)
+        {
+            auto numSamples = juce::jmin (blockSize, signal.getNumSamples() - position);
+            juce::AudioBuffer<SampleType> block (channels.getRawDataPointer(), numChannels, position, numSamples);
+            processor.processBlock (block, position == 0 ? notes : midi);
+        }
+
+        Result result;
+        result.seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        result.stats = processor.getSolverStats();
+
+        processor.releaseResources();
+        output.makeCopyOf (signal);
+        return result;
+    }
+
+    Result render (VCFAudioProcessor& processor, bool doublePrecision, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                   double sampleRate, int blockSize, double fmFrequency, int numVoices, int numMainChannels)
+    {
+        return doublePrecision ? render<double> (processor, input, output, sampleRate, blockSize, fmFrequency, numVoices, numMainChannels)
+                               : render<float>  (processor, input, output, sampleRate, blockSize, fmFrequency, numVoices, numMainChannels);
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        std::cout << usage;
+        return 0;
+    }
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::AudioBuffer<float> fileSignal;
+    double fileRate = 0.0;
+    auto inputFile = args.containsOption ("--in") ? args.getExistingFileForOption ("--in") : juce::File();
+
+    if (inputFile != juce::File() && ! loadFile (inputFile, fileSignal, fileRate))
+    {
+        std::cerr << "Could not read " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto signalType = args.containsOption ("--signal") ? args.getValueForOption ("--signal") : juce::String ("sweep");
+    auto seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : 10.0;
+    auto repeats = args.containsOption ("--repeat") ? juce::jmax (1, args.getValueForOption ("--repeat").getIntValue()) : 1;
+    auto outputFile = args.containsOption ("--out") ? args.getFileForOption ("--out") : juce::File();
+
+    auto rates  = parseList (args, "--rate", fileRate > 0.0 ? fileRate : 48000.0);
+    auto blocks = parseList (args, "--block", 512.0);
+    auto ks     = parseList (args, "--k", 0.5);
+    auto f0s    = parseList (args, "--f0", 1000.0);
+    auto vts    = parseList (args, "--vt", 0.026);
+
+    auto factors = parseList (args, "--oversampling", 4.0);
+    auto fms     = parseList (args, "--fm", 0.0);
+
+    const juce::StringArray qualityNames { "exact", "pade", "table", "adaa" };
+    const juce::StringArray filterNames { "iir", "fir" };
+    auto qualities = parseNames (args, "--quality", "exact");
+    auto filters = parseNames (args, "--filter", "iir");
+
+    const juce::StringArray predictorNames { "previous", "linear", "quadratic" };
+    auto predictors = parseNames (args, "--predictor", "quadratic");
+
+    const juce::StringArray precisionNames { "float", "double" };
+    auto precisions = parseNames (args, "--precision", "float");
+
+    const juce::StringArray ecoNames { "off", "on" };
+    auto ecos = parseNames (args, "--eco", "off");
+
+    const juce::StringArray solverNames { "converge", "fixed" };
+    auto solvers = parseNames (args, "--solver", "converge");
+
+    const juce::StringArray orderNames { "2", "4", "6", "8" };
+    auto orders = parseNames (args, "--order", "4");
+
+    auto voiceCounts = parseList (args, "--voices", 0.0);
+    auto channelCounts = parseList (args, "--channels", 2.0);
+
+    const juce::StringArray linkNames { "off", "auto" };
+    auto links = parseNames (args, "--link", "off");
+
+    VCFAudioProcessor processor;
+
+    // rendering as fast as it can, the governor would only measure the benchmark against itself
+    processor.setNonRealtime (true);
+
+    if (args.containsOption ("--telemetry") && ! processor.startTelemetryLog (args.getFileForOption ("--telemetry")))
+    {
+        std::cerr << "Could not open the telemetry log" << std::endl;
+        return 1;
+    }
+    juce::AudioBuffer<float> output, reference;
+    int run = 0;
+
+    std::cout << "rate\tblock\tK\tf0\tVt\tquality\tos\tfilter\tlatency\tpredictor\tfm\tprecision\teco\tsolver\torder\tvoices\tchannels\tlink\trealtime\tns/sample\titer/sample\tsaved/sample\tnon-converged" << std::endl;
+
+    for (auto rate : rates)
+    {
+        auto input = inputFile != juce::File() ? fileSignal : makeSignal (signalType, rate, seconds);
+
+        for (auto block : blocks)
+         for (auto k : ks)
+          for (auto f0 : f0s)
+           for (auto vt : vts)
+            for (auto& quality : qualities)
+             for (auto factor : factors)
+              for (auto& filter : filters)
+               for (auto& predictor : predictors)
+                for (auto fm : fms)
+                 for (auto& precision : precisions)
+                  for (auto& eco : ecos)
+                   for (auto& solver : solvers)
+                    for (auto& order : orders)
+                     for (auto voiceCount : voiceCounts)
+                      for (auto channelCount : channelCounts)
+                       for (auto& link : links)
+            {
+                auto qualityIndex = qualityNames.indexOf (quality);
+                auto filterIndex = filterNames.indexOf (filter);
+                auto predictorIndex = predictorNames.indexOf (predictor);
+                auto doublePrecision = precisionNames.indexOf (precision) == 1;
+                auto ecoIndex = ecoNames.indexOf (eco);
+                auto solverIndex = solverNames.indexOf (solver);
+                auto orderIndex = orderNames.indexOf (order);
+                auto linkIndex = linkNames.indexOf (link);
+                auto numStages = juce::roundToInt (std::log2 (factor));
+                auto numVoices = juce::jlimit (0, VoicePool::maxVoices, juce::roundToInt (voiceCount));
+                auto numMainChannels = juce::jlimit (1, VCFAudioProcessor::maxChannels, juce::roundToInt (channelCount));
+
+                if (qualityIndex < 0 || filterIndex < 0 || predictorIndex < 0 || ! precisionNames.contains (precision) || ecoIndex < 0 || solverIndex < 0 || orderIndex < 0 || linkIndex < 0)
+                {
+                    std::cerr << "Unknown quality, filter, predictor, precision, eco, solver, order or link setting "
+                              << quality << ", " << filter << ", " << predictor << ", " << precision << ", " << eco << ", " << solver << ", " << order << ", " << link << std::endl;
+                    return 1;
+                }
+
+                if (numStages < 0 || numStages > VCFAudioProcessor::maxOversamplingStages || (1 << numStages) != (int) factor)
+                {
+                    std::cerr << "Unsupported oversampling factor " << factor << std::endl;
+                    return 1;
+                }
+
+                setParameter (processor, "controlK_ID", (float) k);
+                setParameter (processor, "controlF0_ID", (float) f0);
+                setParameter (processor, "controlVt_ID", (float) vt);
+                setParameter (processor, "quality_ID", (float) qualityIndex);
+                setParameter (processor, "oversampling_ID", (float) numStages);
+                setParameter (processor, "oversamplingFilter_ID", (float) filterIndex);
+                setParameter (processor, "eco_ID", (float) ecoIndex);
+                setParameter (processor, "solver_ID", (float) solverIndex);
+                setParameter (processor, "order_ID", (float) orderIndex);
+                setParameter (processor, "poly_ID", numVoices > 0 ? 1.0f : 0.0f);
+                setParameter (processor, "link_ID", (float) linkIndex);
+
+                // iterations saved are counted against starting every sample from the previous solution
+                processor.setPredictor (LadderPredictor::previous);
+                auto unpredicted = render (processor, doublePrecision, input, reference, rate, (int) block, fm, numVoices, numMainChannels).stats;
+                processor.setPredictor (static_cast<LadderPredictor> (predictorIndex));
+
+                Result best;
+
+                for (int i = 0; i < repeats; ++i)
+                {
+                    auto result = render (processor, doublePrecision, input, output, rate, (int) block, fm, numVoices, numMainChannels);
+
+                    if (i == 0 || result.seconds < best.seconds)
+                        best = result;
+                }
+
+                auto numFrames = (double) input.getNumSamples();
+                auto audioSeconds = numFrames / rate;
+                auto nsPerSample = best.seconds * 1.0e9 / (numFrames * numMainChannels);
+                auto samples = (double) juce::jmax ((juce::uint64) 1, best.stats.samples);
+                auto saved = ((double) unpredicted.iterations - (double) best.stats.iterations) / samples;
+
+                std::cout << rate << "\t" << (int) block << "\t" << k << "\t" << f0 << "\t" << vt << "\t" << quality << "\t"
+                          << (int) factor << "x\t" << filter << "\t" << processor.getLatencySamples() << "\t" << predictor << "\t" << fm << "\t" << precision << "\t" << eco << "\t" << solver << "\t" << order << "\t" << numVoices << "\t" << numMainChannels << "\t" << link << "\t"
+                          << juce::String (audioSeconds / best.seconds, 1) << "x\t"
+                          << juce::String (nsPerSample, 1) << "\t"
+                          << juce::String ((double) best.stats.iterations / samples, 3) << "\t"
+                          << juce::String (saved, 3) << "\t"
+                          << juce::String ((double) best.stats.nonConverged / samples, 6) << std::endl;
+
+                if (outputFile != juce::File())
+                {
+                    auto file = run == 0 ? outputFile
+                                         : outputFile.getSiblingFile (outputFile.getFileNameWithoutExtension()
+                                                                      + "_" + juce::String (run) + outputFile.getFileExtension());
+
+                    if (! writeFile (file, output, rate))
+                        std::cerr << "Could not write " << file.getFullPathName() << std::endl;
+                }
+
+                ++run;
+            }
+    }
+
+    return 0;
+}
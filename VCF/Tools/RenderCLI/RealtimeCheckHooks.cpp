@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Global allocation and lock hooks for VCF_REALTIME_CHECKS builds.
+
+    Replaces the global operator new/delete and, where the platform allows
+    it, interposes malloc and pthread_mutex_lock, so that any of them called
+    from inside VCFAudioProcessor::processBlock aborts the process. Only link
+    this into test executables, never into the plugin.
+
+  ==============================================================================
+*/
+
+#include "RealtimeCheck.h"
+
+#if VCF_REALTIME_CHECKS
+
+#include <cstdlib>
+#include <new>
+
+#if defined (__linux__) || defined (__APPLE__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+    void* allocate (std::size_t size)
+    {
+        RealtimeCheck::check ("operator new");
+
+        if (auto* p = std::malloc (size == 0 ? 1 : size))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned (std::size_t size, std::align_val_t alignment)
+    {
+        RealtimeCheck::check ("operator new");
+
+        auto align = static_cast<std::size_t> (alignment);
+        size = (size + align - 1) / align * align;
+
+        if (auto* p = std::aligned_alloc (align, size == 0 ? align : size))
+            return p;
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate (void* p) noexcept
+    {
+        if (p != nullptr)
+            RealtimeCheck::check ("operator delete");
+
+        std::free (p);
+    }
+}
+
+void* operator new   (std::size_t size)                               { return allocate (size); }
+void* operator new[] (std::size_t size)                               { return allocate (size); }
+void* operator new   (std::size_t size, std::align_val_t alignment)   { return allocateAligned (size, alignment); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)   { return allocateAligned (size, alignment); }
+
+void operator delete   (void* p) noexcept                             { deallocate (p); }
+void operator delete[] (void* p) noexcept                             { deallocate (p); }
+void operator delete   (void* p, std::size_t) noexcept                { deallocate (p); }
+void operator delete[] (void* p, std::size_t) noexcept                { deallocate (p); }
+void operator delete   (void* p, std::align_val_t) noexcept           { deallocate (p); }
+void operator delete[] (void* p, std::align_val_t) noexcept           { deallocate (p); }
+void operator delete   (void* p, std::size_t, std::align_val_t) noexcept  { deallocate (p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept  { deallocate (p); }
+
+//==============================================================================
+#if defined (__GLIBC__)
+// glibc exports its allocator under __libc_* names, which lets these forward
+// without going through dlsym (which itself allocates).
+extern "C"
+{
+    void* __libc_malloc (std::size_t);
+    void* __libc_calloc (std::size_t, std::size_t);
+    void* __libc_realloc (void*, std::size_t);
+
+    void* malloc (std::size_t size)                     { RealtimeCheck::check ("malloc");  return __libc_malloc (size); }
+    void* calloc (std::size_t count, std::size_t size)  { RealtimeCheck::check ("calloc");  return __libc_calloc (count, size); }
+    void* realloc (void* p, std::size_t size)           { RealtimeCheck::check ("realloc"); return __libc_realloc (p, size); }
+}
+#endif
+
+#if defined (__linux__) || defined (__APPLE__)
+namespace
+{
+    using LockFunction = int (*) (pthread_mutex_t*);
+    LockFunction realLock = nullptr;
+
+    LockFunction resolveLock() noexcept
+    {
+        return reinterpret_cast<LockFunction> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+    }
+
+    // The real lock is looked up before the other static initialisers run rather than
+    // on the first lock, which could come from processBlock: dlsym allocates, and a
+    // function-local static is initialised behind a guard that may lock in turn.
+    __attribute__ ((constructor (101))) void resolveLockAtStartup() noexcept
+    {
+        realLock = resolveLock();
+    }
+}
+
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RealtimeCheck::check ("pthread_mutex_lock");
+
+    // only a lock taken by another library's startup code, before ours ran, gets here
+    if (realLock == nullptr)
+        realLock = resolveLock();
+
+    return realLock (mutex);
+}
+#endif
+
+#endif